@@ -0,0 +1,203 @@
+#pragma once
+
+/* Helpers shared by the benchmarks: percentiles, command line options,
+   JSON output and a scratch directory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <log/utils.h>
+
+#if defined (_WIN32)
+  #include <direct.h>
+#else
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace bench {
+
+inline int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Percentiles {
+  int64_t p50;
+  int64_t p99;
+  int64_t p999;
+  int64_t max;
+
+  Percentiles() : p50(0), p99(0), p999(0), max(0) {}
+};
+
+/* Sorts samples */
+inline Percentiles percentiles(std::vector<int64_t>& samples) {
+  Percentiles result;
+  if (samples.empty())
+    return result;
+
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double q) { return samples[(size_t)(q * (samples.size() - 1))]; };
+  result.p50 = at(0.5);
+  result.p99 = at(0.99);
+  result.p999 = at(0.999);
+  result.max = samples.back();
+  return result;
+}
+
+/* "--name value" pairs */
+class Options {
+public:
+  Options(int argc, char* argv[]) : m_argc(argc), m_argv(argv) {}
+
+  std::string get(const std::string& name, const std::string& defaultValue) const {
+    for (int i = 1; i + 1 < m_argc; ++i) {
+      if (name == m_argv[i])
+        return m_argv[i + 1];
+    }
+    return defaultValue;
+  }
+
+  int64_t get(const std::string& name, int64_t defaultValue) const {
+    auto value = get(name, std::string());
+    return value.empty() ? defaultValue : std::stoll(value);
+  }
+
+private:
+  int m_argc;
+  char** m_argv;
+};
+
+/* Builds one JSON object, values are added in order */
+class JsonObject {
+public:
+  JsonObject& add(const std::string& key, const std::string& value) {
+    return addRaw(key, quote(value));
+  }
+
+  JsonObject& add(const std::string& key, const char* value) {
+    return addRaw(key, quote(value));
+  }
+
+  JsonObject& add(const std::string& key, int64_t value) {
+    return addRaw(key, std::to_string(value));
+  }
+
+  JsonObject& add(const std::string& key, int value) {
+    return addRaw(key, std::to_string(value));
+  }
+
+  JsonObject& add(const std::string& key, size_t value) {
+    return addRaw(key, std::to_string(value));
+  }
+
+  JsonObject& add(const std::string& key, double value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.6g", value);
+    return addRaw(key, buf);
+  }
+
+  JsonObject& add(const std::string& key, const Percentiles& value) {
+    return add(key, JsonObject()
+        .add("p50", value.p50)
+        .add("p99", value.p99)
+        .add("p99.9", value.p999)
+        .add("max", value.max));
+  }
+
+  JsonObject& add(const std::string& key, const JsonObject& value) {
+    return addRaw(key, value.str());
+  }
+
+  JsonObject& add(const std::string& key, const std::vector<JsonObject>& values) {
+    std::string array = "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+      array += (i == 0 ? "\n" : ",\n") + values[i].str();
+    }
+    return addRaw(key, array + "\n]");
+  }
+
+  std::string str() const { return "{" + m_body + "}"; }
+
+private:
+  JsonObject& addRaw(const std::string& key, const std::string& value) {
+    if (!m_body.empty())
+      m_body += ", ";
+    m_body += quote(key) + ": " + value;
+    return *this;
+  }
+
+  static std::string quote(const std::string& s) {
+    std::string result = "\"";
+    for (auto c: s) {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      result += c;
+    }
+    return result + "\"";
+  }
+
+private:
+  std::string m_body;
+};
+
+/* Writes to fileName or, if it is empty, to stdout */
+inline void writeJson(const JsonObject& json, const std::string& fileName) {
+  FILE* out = fileName.empty() ? stdout : fopen(fileName.c_str(), "w");
+  if (out == nullptr)
+    throw std::runtime_error("bench: can't open " + fileName);
+  fprintf(out, "%s\n", json.str().c_str());
+  if (out != stdout)
+    fclose(out);
+}
+
+/* Empty directory removed with its files on destruction */
+class ScratchDir {
+public:
+  explicit ScratchDir(const std::string& parent) {
+    static int counter = 0;
+    m_name = sl::detail::fs::join(parent, "sl_bench_" + std::to_string(nowNs()) +
+                                          "_" + std::to_string(counter++));
+#if defined (_WIN32)
+    bool created = _mkdir(m_name.c_str()) == 0;
+#else
+    bool created = mkdir(m_name.c_str(), 0755) == 0;
+#endif
+    if (!created)
+      throw std::runtime_error("bench: can't create " + m_name);
+  }
+
+  ~ScratchDir() {
+    clear();
+#if defined (_WIN32)
+    _rmdir(m_name.c_str());
+#else
+    rmdir(m_name.c_str());
+#endif
+  }
+
+  void clear() {
+    using sl::detail::fs::Dir;
+    std::vector<std::string> files;
+    Dir(m_name).forEachEntry([&files, this](const Dir::Entry& entry) {
+      if (entry.type == Dir::file)
+        files.push_back(sl::detail::fs::join(m_name, entry.name));
+    });
+    for (const auto& file: files) {
+      remove(file.c_str());
+    }
+  }
+
+  const std::string& name() const { return m_name; }
+
+private:
+  std::string m_name;
+};
+
+}
@@ -0,0 +1,218 @@
+/* Per record cost of sl formatting against snprintf and std::ostringstream
+   for several argument mixes: nanoseconds and heap allocations per
+   record, the latter counted by the replaced global operator new. "record"
+   is what Logger does for each record: a new stringstream, writeLogData
+   and detail::fmt.
+
+   format_bench [--iterations N] [--out file.json] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <log/log.h>
+#include <log/format.h>
+#include "bench_utils.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations(0);
+
+}
+
+void* operator new(size_t size) {
+  ++g_allocations;
+  if (void* p = malloc(size == 0 ? 1 : size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+namespace {
+
+struct Point {
+  int x;
+  int y;
+};
+
+std::ostream& operator<<(std::ostream& out, const Point& point) {
+  return out << point.x << "," << point.y;
+}
+
+const std::string kShort = "short";
+const std::string kLong(512, 'l');
+const Point kPoint = {12, -34};
+
+enum class Engine {
+  slFmt,
+  record,
+  writeLogData,
+  snprintf,
+  ostringstream
+};
+
+enum class Mix {
+  ints,
+  doubles,
+  shortStrings,
+  longString,
+  custom,
+  mixed
+};
+
+const char* name(Engine engine) {
+  switch (engine) {
+    case Engine::slFmt:         return "sl::fmt";
+    case Engine::record:        return "record";
+    case Engine::writeLogData:  return "writeLogData";
+    case Engine::snprintf:      return "snprintf";
+    case Engine::ostringstream: return "ostringstream";
+  }
+  return "";
+}
+
+const char* name(Mix mix) {
+  switch (mix) {
+    case Mix::ints:         return "ints";
+    case Mix::doubles:      return "doubles";
+    case Mix::shortStrings: return "short strings";
+    case Mix::longString:   return "long string";
+    case Mix::custom:       return "custom type";
+    case Mix::mixed:        return "mixed";
+  }
+  return "";
+}
+
+template<typename... Args>
+size_t slFormat(const char* format, Args&&... args) {
+  return sl::fmt(format, std::forward<Args>(args)...).size();
+}
+
+template<typename... Args>
+size_t recordFormat(const char* format, Args&&... args) {
+  std::stringstream out;
+  sl::detail::writeLogData(out, sl::Level::info, "%Y-%m-%d %H:%M:%S",
+                           1489269059129000ll);
+  sl::detail::fmt(out, format, std::forward<Args>(args)...);
+  out << std::endl << std::endl;
+  return out.str().size();
+}
+
+template<typename... Args>
+size_t streamFormat(Args&&... args) {
+  std::ostringstream out;
+  using Expand = int[];
+  (void)Expand{0, (out << std::forward<Args>(args) << ' ', 0)...};
+  return out.str().size();
+}
+
+template<typename... Args>
+size_t printfFormat(const char* format, Args... args) {
+  char buf[1024];
+  return (size_t)snprintf(buf, sizeof(buf), format, args...);
+}
+
+template<typename Format>
+size_t placeholderFormat(Format format, Mix mix, int i, double d) {
+  switch (mix) {
+    case Mix::ints:         return format("% % % %", i, i * 7, -i, 42);
+    case Mix::doubles:      return format("% %", d, d * 3.5);
+    case Mix::shortStrings: return format("% %", kShort, "literal");
+    case Mix::longString:   return format("%", kLong);
+    case Mix::custom:       return format("%", kPoint);
+    case Mix::mixed:        return format("% % % %", i, d, kShort, kPoint);
+  }
+  return 0;
+}
+
+size_t formatOne(Engine engine, Mix mix, int i) {
+  double d = i * 0.25;
+  switch (engine) {
+    case Engine::slFmt:
+      return placeholderFormat(
+          [](const char* f, const auto&... a) { return slFormat(f, a...); }, mix, i, d);
+    case Engine::record:
+      return placeholderFormat(
+          [](const char* f, const auto&... a) { return recordFormat(f, a...); }, mix, i, d);
+    case Engine::writeLogData: {
+      std::stringstream out;
+      sl::detail::writeLogData(out, sl::Level::info, "%Y-%m-%d %H:%M:%S",
+                               1489269059129000ll + i);
+      return out.str().size();
+    }
+    case Engine::snprintf:
+      switch (mix) {
+        case Mix::ints:         return printfFormat("%d %d %d %d", i, i * 7, -i, 42);
+        case Mix::doubles:      return printfFormat("%g %g", d, d * 3.5);
+        case Mix::shortStrings: return printfFormat("%s %s", kShort.c_str(), "literal");
+        case Mix::longString:   return printfFormat("%s", kLong.c_str());
+        case Mix::custom:       return printfFormat("%d,%d", kPoint.x, kPoint.y);
+        case Mix::mixed:
+          return printfFormat("%d %g %s %d,%d", i, d, kShort.c_str(), kPoint.x, kPoint.y);
+      }
+      break;
+    case Engine::ostringstream:
+      switch (mix) {
+        case Mix::ints:         return streamFormat(i, i * 7, -i, 42);
+        case Mix::doubles:      return streamFormat(d, d * 3.5);
+        case Mix::shortStrings: return streamFormat(kShort, "literal");
+        case Mix::longString:   return streamFormat(kLong);
+        case Mix::custom:       return streamFormat(kPoint);
+        case Mix::mixed:        return streamFormat(i, d, kShort, kPoint);
+      }
+      break;
+  }
+  return 0;
+}
+
+bench::JsonObject run(Engine engine, Mix mix, int64_t iterations) {
+  size_t bytes = 0;
+  auto allocations = g_allocations.load();
+  auto start = bench::nowNs();
+  for (int64_t i = 0; i < iterations; ++i) {
+    bytes += formatOne(engine, mix, (int)i);
+  }
+  auto elapsed = bench::nowNs() - start;
+  allocations = g_allocations.load() - allocations;
+
+  return bench::JsonObject()
+      .add("engine", name(engine))
+      .add("args", name(mix))
+      .add("nsPerRecord", (double)elapsed / iterations)
+      .add("allocationsPerRecord", (double)allocations / iterations)
+      .add("bytesPerRecord", (double)bytes / iterations);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  bench::Options options(argc, argv);
+  auto iterations = options.get("--iterations", (int64_t)200 * 1000);
+
+  std::vector<bench::JsonObject> results;
+  for (auto mix: {Mix::ints, Mix::doubles, Mix::shortStrings,
+                  Mix::longString, Mix::custom, Mix::mixed}) {
+    for (auto engine: {Engine::slFmt, Engine::record, Engine::snprintf,
+                       Engine::ostringstream}) {
+      results.push_back(run(engine, mix, iterations));
+    }
+  }
+  results.push_back(run(Engine::writeLogData, Mix::ints, iterations));
+
+  bench::writeJson(bench::JsonObject()
+                       .add("benchmark", "format_bench")
+                       .add("iterations", iterations)
+                       .add("results", results),
+                   options.get("--out", std::string()));
+  return 0;
+}
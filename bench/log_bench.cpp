@@ -0,0 +1,158 @@
+/* Throughput and per call latency of LOG and LOG_S. Each scenario changes
+   one parameter of the baseline (one thread, 128 byte payload, mixed
+   arguments, enabled level, 64 MB files) and logs to a new sink.
+
+   log_bench [--records N] [--dir parent] [--out file.json] */
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <log/log.h>
+#include "bench_utils.h"
+
+namespace {
+
+enum class Macro {
+  log,
+  logS
+};
+
+enum class Args {
+  text,  /* the payload only */
+  ints,  /* four ints and the payload */
+  mixed  /* int, double, C string and the payload */
+};
+
+struct Scenario {
+  const char* name;
+  Macro macro;
+  int threads;
+  size_t messageSize;
+  Args args;
+  bool filtered;
+  int64_t fileLimit;
+};
+
+const int64_t kLargeFile = 64 * 1024 * 1024ll;
+const int64_t kSmallFile = 1024 * 1024ll;
+
+const Scenario kScenarios[] = {
+  {"baseline",       Macro::logS, 1, 128,  Args::mixed, false, kLargeFile},
+  {"default sink",   Macro::log,  1, 128,  Args::mixed, false, kLargeFile},
+  {"2 threads",      Macro::logS, 2, 128,  Args::mixed, false, kLargeFile},
+  {"4 threads",      Macro::logS, 4, 128,  Args::mixed, false, kLargeFile},
+  {"8 threads",      Macro::logS, 8, 128,  Args::mixed, false, kLargeFile},
+  {"16 byte",        Macro::logS, 1, 16,   Args::mixed, false, kLargeFile},
+  {"1024 byte",      Macro::logS, 1, 1024, Args::mixed, false, kLargeFile},
+  {"text",           Macro::logS, 1, 128,  Args::text,  false, kLargeFile},
+  {"ints",           Macro::logS, 1, 128,  Args::ints,  false, kLargeFile},
+  {"filtered",       Macro::logS, 1, 128,  Args::mixed, true,  kLargeFile},
+  {"filtered 8 threads", Macro::logS, 8, 128, Args::mixed, true, kLargeFile},
+  {"1 MB files",     Macro::logS, 1, 128,  Args::mixed, false, kSmallFile},
+  {"1 MB files 8 threads", Macro::logS, 8, 128, Args::mixed, false, kSmallFile},
+};
+
+const char* name(Macro macro) {
+  return macro == Macro::log ? "LOG" : "LOG_S";
+}
+
+const char* name(Args args) {
+  switch (args) {
+    case Args::text:  return "text";
+    case Args::ints:  return "ints";
+    case Args::mixed: return "mixed";
+  }
+  return "";
+}
+
+void logOne(const Scenario& scenario, int sinkId, const std::string& payload, int i) {
+  if (scenario.macro == Macro::log) {
+    switch (scenario.args) {
+      case Args::text:  LOG(sl::Level::info, "%", payload); break;
+      case Args::ints:  LOG(sl::Level::info, "% % % % %", i, i * 7, -i, 42, payload); break;
+      case Args::mixed: LOG(sl::Level::info, "% % % %", i, i * 0.5, "value", payload); break;
+    }
+    return;
+  }
+
+  switch (scenario.args) {
+    case Args::text:  LOG_S(sinkId, sl::Level::info, "%", payload); break;
+    case Args::ints:  LOG_S(sinkId, sl::Level::info, "% % % % %", i, i * 7, -i, 42, payload); break;
+    case Args::mixed: LOG_S(sinkId, sl::Level::info, "% % % %", i, i * 0.5, "value", payload); break;
+  }
+}
+
+bench::JsonObject run(const Scenario& scenario, int sinkId, int64_t records,
+                      const bench::ScratchDir& dir) {
+  auto& logger = sl::Logger::getLogger();
+  auto level = scenario.filtered ? sl::Level::error : sl::Level::debug;
+  auto baseName = "bench" + std::to_string(sinkId);
+  if (scenario.macro == Macro::log) {
+    logger.setDefaultSink(dir.name(), baseName, level, scenario.fileLimit * 4,
+                          scenario.fileLimit);
+  } else {
+    logger.addSink(sinkId, dir.name(), baseName, level, scenario.fileLimit * 4,
+                   scenario.fileLimit);
+  }
+
+  const std::string payload(scenario.messageSize, 'x');
+  auto perThread = (int)(records / scenario.threads);
+  std::vector<std::vector<int64_t>> latencies(scenario.threads);
+  std::vector<std::thread> threads;
+
+  auto start = bench::nowNs();
+  for (int t = 0; t < scenario.threads; ++t) {
+    threads.emplace_back([&, t] {
+      auto& samples = latencies[t];
+      samples.reserve(perThread);
+      for (int i = 0; i < perThread; ++i) {
+        auto callStart = bench::nowNs();
+        logOne(scenario, sinkId, payload, i);
+        samples.push_back(bench::nowNs() - callStart);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  auto elapsed = bench::nowNs() - start;
+
+  std::vector<int64_t> all;
+  for (const auto& samples: latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+
+  return bench::JsonObject()
+      .add("name", scenario.name)
+      .add("macro", name(scenario.macro))
+      .add("threads", scenario.threads)
+      .add("messageSize", scenario.messageSize)
+      .add("args", name(scenario.args))
+      .add("level", scenario.filtered ? "filtered" : "enabled")
+      .add("fileLimit", scenario.fileLimit)
+      .add("records", (int64_t)all.size())
+      .add("recordsPerSec", all.size() * 1e9 / elapsed)
+      .add("latencyNs", bench::percentiles(all));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  bench::Options options(argc, argv);
+  auto records = options.get("--records", (int64_t)100 * 1000);
+  bench::ScratchDir dir(options.get("--dir", std::string(".")));
+
+  std::vector<bench::JsonObject> results;
+  int sinkId = 0;
+  for (const auto& scenario: kScenarios) {
+    results.push_back(run(scenario, ++sinkId, records, dir));
+    fprintf(stderr, "%s done\n", scenario.name);
+  }
+
+  bench::writeJson(bench::JsonObject()
+                       .add("benchmark", "log_bench")
+                       .add("recordsPerScenario", records)
+                       .add("results", results),
+                   options.get("--out", std::string()));
+  return 0;
+}
@@ -0,0 +1,128 @@
+/* Size rotation cost against the number of retained files. The directory
+   is filled with files-1 rotated files first, so every measured rotation
+   renames all of them and removes the oldest one, either inline (total
+   limit) or in the background (retention maxFiles). Writers share the
+   manager under a mutex like the synchronous sinks do; the rotation time
+   is taken inside the lock, the writer latency includes the wait for it.
+
+   rotation_bench [--rotations N] [--writers N] [--dir parent] [--out file.json] */
+
+#include <stdio.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <log/log_files_manager.h>
+#include <log/file_entry.h>
+#include <log/file_entry_catalog.h>
+#include "bench_utils.h"
+
+using namespace sl::detail;
+
+namespace {
+
+const int64_t kFileLimit = 4096;
+const size_t kRecordSize = 256;
+const int64_t kWritesPerFile = kFileLimit / kRecordSize;
+const char* kBaseName = "rotation";
+
+void populate(const std::string& dir, int64_t files) {
+  const std::string content(kFileLimit, 'x');
+  for (int64_t i = 1; i < files; ++i) {
+    auto name = str::join(fs::join(dir, kBaseName), std::to_string(i), kLogFileExtension);
+    FILE* file = fopen(name.c_str(), "wb");
+    if (file == nullptr || fwrite(content.data(), content.size(), 1, file) != 1)
+      throw std::runtime_error("rotation_bench: can't write " + name);
+    fclose(file);
+  }
+}
+
+bench::JsonObject run(int64_t files, bool retention, int64_t rotations, int writers,
+                      const std::string& parent) {
+  bench::ScratchDir dir(parent);
+  populate(dir.name(), files);
+
+  sl::SinkOptions options(files * kFileLimit, kFileLimit);
+  if (retention) {
+    options.totalLimit = 1000 * 1000 * 1000ll * 1000;
+    options.retention = sl::RetentionOptions(0, (size_t)files);
+  }
+
+  FileEntryFactory factory;
+  auto loadStart = bench::nowNs();
+  LogFilesManager manager(
+      FileEntryCatalogPtr(new FileEntryCatalog(&factory, dir.name(), kBaseName)), options);
+  auto loadTime = bench::nowNs() - loadStart;
+
+  const std::string record(kRecordSize - 2, 'r');
+  const std::string data = record + "\n\n";
+  std::mutex mutex;
+  int64_t written = 0;
+  const int64_t total = rotations * kWritesPerFile;
+  std::vector<int64_t> rotationTimes;
+  std::vector<std::vector<int64_t>> latencies(writers);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < writers; ++t) {
+    threads.emplace_back([&, t] {
+      while (true) {
+        auto callStart = bench::nowNs();
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (written == total)
+            return;
+          /* the manager rotates when the written bytes cross a file limit */
+          bool rotates = (written + 1) % kWritesPerFile == 0;
+          auto writeStart = bench::nowNs();
+          manager.write(data.data(), data.size(), 0);
+          if (rotates)
+            rotationTimes.push_back(bench::nowNs() - writeStart);
+          ++written;
+        }
+        latencies[t].push_back(bench::nowNs() - callStart);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+
+  std::vector<int64_t> all;
+  for (const auto& samples: latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+
+  return bench::JsonObject()
+      .add("files", files)
+      .add("removal", retention ? "retention" : "totalLimit")
+      .add("writers", writers)
+      .add("loadNs", loadTime)
+      .add("rotations", (int64_t)rotationTimes.size())
+      .add("rotationNs", bench::percentiles(rotationTimes))
+      .add("writerLatencyNs", bench::percentiles(all));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  bench::Options options(argc, argv);
+  auto rotations = options.get("--rotations", (int64_t)100);
+  auto writers = (int)options.get("--writers", (int64_t)4);
+  auto parent = options.get("--dir", std::string("."));
+
+  std::vector<bench::JsonObject> results;
+  for (int64_t files: {10, 100, 1000, 10000}) {
+    for (bool retention: {false, true}) {
+      results.push_back(run(files, retention, rotations, writers, parent));
+      fprintf(stderr, "%lld files%s done\n", (long long)files, retention ? ", retention" : "");
+    }
+  }
+
+  bench::writeJson(bench::JsonObject()
+                       .add("benchmark", "rotation_bench")
+                       .add("fileLimit", kFileLimit)
+                       .add("recordSize", kRecordSize)
+                       .add("results", results),
+                   options.get("--out", std::string()));
+  return 0;
+}
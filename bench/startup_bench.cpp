@@ -0,0 +1,165 @@
+/* Logger::addSink time over directories holding many files: rotated files
+   of the sink and files of other names, which the catalog scan has to
+   skip. With glibc 2.33+ the file system calls made by addSink are
+   counted by interposing the libc functions the catalog uses.
+
+   startup_bench [--runs N] [--dir parent] [--out file.json] */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <log/log.h>
+#include <log/file_entry.h>
+#include "bench_utils.h"
+
+#if defined (__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  #define SL_COUNT_CALLS
+  #include <dlfcn.h>
+  #include <dirent.h>
+  #include <sys/stat.h>
+#endif
+
+using namespace sl::detail;
+
+namespace {
+
+enum Call {
+  statCall,
+  opendirCall,
+  readdirCall,
+  fopenCall,
+  renameCall,
+  removeCall,
+  callCount
+};
+
+const char* kCallNames[callCount] = {"stat", "opendir", "readdir", "fopen", "rename", "remove"};
+uint64_t g_calls[callCount];
+bool g_counting = false;
+
+void count(Call call) {
+  if (g_counting)
+    ++g_calls[call];
+}
+
+}
+
+#if defined (SL_COUNT_CALLS)
+
+template<typename Function>
+Function next(const char* name) {
+  return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+extern "C" {
+
+int stat(const char* path, struct stat* buf) noexcept {
+  static auto real = next<int(*)(const char*, struct stat*)>("stat");
+  count(statCall);
+  return real(path, buf);
+}
+
+DIR* opendir(const char* name) {
+  static auto real = next<DIR*(*)(const char*)>("opendir");
+  count(opendirCall);
+  return real(name);
+}
+
+struct dirent* readdir(DIR* dir) {
+  static auto real = next<struct dirent*(*)(DIR*)>("readdir");
+  count(readdirCall);
+  return real(dir);
+}
+
+FILE* fopen(const char* name, const char* mode) {
+  static auto real = next<FILE*(*)(const char*, const char*)>("fopen");
+  count(fopenCall);
+  return real(name, mode);
+}
+
+int rename(const char* from, const char* to) noexcept {
+  static auto real = next<int(*)(const char*, const char*)>("rename");
+  count(renameCall);
+  return real(from, to);
+}
+
+int remove(const char* name) noexcept {
+  static auto real = next<int(*)(const char*)>("remove");
+  count(removeCall);
+  return real(name);
+}
+
+}
+
+#endif
+
+namespace {
+
+const char* kBaseName = "startup";
+
+void populate(const std::string& dir, const std::string& baseName, int64_t files) {
+  const std::string content(64, 'x');
+  for (int64_t i = 1; i <= files; ++i) {
+    auto name = str::join(fs::join(dir, baseName), std::to_string(i), kLogFileExtension);
+    FILE* file = fopen(name.c_str(), "wb");
+    if (file == nullptr || fwrite(content.data(), content.size(), 1, file) != 1)
+      throw std::runtime_error("startup_bench: can't write " + name);
+    fclose(file);
+  }
+}
+
+bench::JsonObject run(int64_t matching, int64_t other, int64_t runs, const std::string& parent) {
+  bench::ScratchDir dir(parent);
+  populate(dir.name(), kBaseName, matching);
+  populate(dir.name(), "other", other);
+
+  std::vector<int64_t> times;
+  uint64_t calls[callCount] = {};
+  for (int64_t i = 0; i < runs; ++i) {
+    sl::Logger logger;
+    std::fill(g_calls, g_calls + callCount, 0);
+    g_counting = true;
+    auto start = bench::nowNs();
+    logger.addSink(1, dir.name(), kBaseName, sl::Level::info,
+                   1000 * 1000 * 1000ll * 1000, 1000 * 1000);
+    times.push_back(bench::nowNs() - start);
+    g_counting = false;
+    std::copy(g_calls, g_calls + callCount, calls);
+  }
+
+  bench::JsonObject callsJson;
+#if defined (SL_COUNT_CALLS)
+  for (int call = 0; call < callCount; ++call) {
+    callsJson.add(kCallNames[call], (int64_t)calls[call]);
+  }
+#endif
+
+  return bench::JsonObject()
+      .add("matchingFiles", matching)
+      .add("otherFiles", other)
+      .add("runs", runs)
+      .add("addSinkNs", bench::percentiles(times))
+      .add("calls", callsJson);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  bench::Options options(argc, argv);
+  auto runs = options.get("--runs", (int64_t)5);
+  auto parent = options.get("--dir", std::string("."));
+
+  std::vector<bench::JsonObject> results;
+  for (int64_t files: {1000, 10000, 100000}) {
+    for (int64_t other: {(int64_t)0, files}) {
+      results.push_back(run(files, other, runs, parent));
+      fprintf(stderr, "%lld files, %lld other done\n", (long long)files, (long long)other);
+    }
+  }
+
+  bench::writeJson(bench::JsonObject()
+                       .add("benchmark", "startup_bench")
+                       .add("results", results),
+                   options.get("--out", std::string()));
+  return 0;
+}
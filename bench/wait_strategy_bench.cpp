@@ -0,0 +1,110 @@
+/* Writer thread wake-up latency against the CPU time it burns, for each
+   wait strategy. Records are sent in bursts separated by pauses, the
+   writer only takes the time, so the queue and the wait are measured. */
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <log/async_writer.h>
+#include <log/utils.h>
+
+#if defined (__unix__) || defined (__APPLE__)
+  #include <sys/resource.h>
+#endif
+
+using namespace sl::detail;
+
+namespace {
+
+const int kBursts = 200;
+const int kBurstSize = 100;
+const std::chrono::microseconds kPause(2000);
+
+double cpuSeconds() {
+#if defined (__unix__) || defined (__APPLE__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+  return 0;
+#endif
+}
+
+struct Result {
+  int64_t p50;
+  int64_t p99;
+  int64_t max;
+  double cpu;
+  uint64_t wakeups;
+};
+
+Result run(sl::WaitStrategy strategy, bool perThread) {
+  sl::AsyncOptions options(64 * 1024);
+  options.waitStrategy = strategy;
+  options.perThread = perThread;
+
+  std::vector<int64_t> latencies;
+  latencies.reserve(kBursts * kBurstSize);
+  auto write = [&latencies](const Record& record) { 
+    latencies.push_back(ts::now() - record.timestamp); 
+  };
+
+  Result result;
+  auto startCpu = cpuSeconds();
+  auto start = std::chrono::steady_clock::now();
+  {
+    AsyncWriter writer(options, write, [](uint64_t) {});
+    for (int burst = 0; burst < kBursts; ++burst) {
+      for (int i = 0; i < kBurstSize; ++i) {
+        writer.push(Record(std::string(), ts::now(), sl::Level::info));
+      }
+      std::this_thread::sleep_for(kPause);
+    }
+    writer.flush();
+    result.wakeups = writer.wakeups();
+  }
+  auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  result.p50 = latencies[latencies.size() / 2];
+  result.p99 = latencies[latencies.size() * 99 / 100];
+  result.max = latencies.back();
+  /* cores busy on average, the producer sleeps most of the time */
+  result.cpu = (cpuSeconds() - startCpu) / wall;
+
+  return result;
+}
+
+const char* name(sl::WaitStrategy strategy) {
+  switch (strategy) {
+    case sl::WaitStrategy::spin:      return "spin";
+    case sl::WaitStrategy::spinYield: return "spinYield";
+    case sl::WaitStrategy::park:      return "park";
+  }
+  return "";
+}
+
+}
+
+int main() {
+  printf("%-10s %-10s %10s %10s %10s %8s %10s\n", 
+         "strategy", "queue", "p50 us", "p99 us", "max us", "cores", "wakeups");
+
+  for (auto perThread: {false, true}) {
+    for (auto strategy: {sl::WaitStrategy::spin, 
+                         sl::WaitStrategy::spinYield, 
+                         sl::WaitStrategy::park}) {
+      auto result = run(strategy, perThread);
+      printf("%-10s %-10s %10lld %10lld %10lld %8.2f %10llu\n",
+             name(strategy), perThread ? "perThread" : "shared",
+             (long long)result.p50, (long long)result.p99, (long long)result.max,
+             result.cpu, (unsigned long long)result.wakeups);
+    }
+  }
+
+  return 0;
+}
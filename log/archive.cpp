@@ -0,0 +1,300 @@
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+#include <log/archive.h>
+#include <log/lz.h>
+#include <log/format.h>
+#include <log/thread_options.h>
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+const char kMagic[4] = {'S', 'L', 'Z', '2'};
+const char kIndexMagic[4] = {'S', 'L', 'Z', 'I'};
+const uint32_t kStoredFlag = 0x80000000;
+const size_t kMaxBlockSize = 16 * kArchiveBlockSize;
+const size_t kBlocksPerThread = 8;
+const size_t kBlockHeaderSize = 8;
+const size_t kIndexEntrySize = 20;
+const size_t kTrailerSize = 16;
+
+struct PendingBlock {
+  std::vector<char> raw;
+  std::vector<char> compressed;
+  size_t size;
+  int64_t timestamp;
+};
+
+void putU32(char* p, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    p[i] = (char)(value >> (8 * i));
+  }
+}
+
+void putU64(char* p, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    p[i] = (char)(value >> (8 * i));
+  }
+}
+
+uint32_t getU32(const char* p) {
+  uint32_t result = 0;
+  for (int i = 0; i < 4; ++i) {
+    result |= (uint32_t)(uint8_t)p[i] << (8 * i);
+  }
+  return result;
+}
+
+uint64_t getU64(const char* p) {
+  uint64_t result = 0;
+  for (int i = 0; i < 8; ++i) {
+    result |= (uint64_t)(uint8_t)p[i] << (8 * i);
+  }
+  return result;
+}
+
+int seek(FILE* file, int64_t offset, int whence) {
+#if defined (_WIN32)
+  return _fseeki64(file, offset, whence);
+#else
+  return fseeko(file, (off_t)offset, whence);
+#endif
+}
+
+void writeAll(FILE* out, const void* data, size_t size, const std::string& name) {
+  if (size != 0 && fwrite(data, size, 1, out) != 1)
+    throw std::runtime_error(sl::fmt("archive: write to % failed", name));
+}
+
+void compressBlock(PendingBlock& block) {
+  block.compressed.resize(lz::compressBound(block.raw.size()));
+  block.size = lz::compress(block.raw.data(),
+                            block.raw.size(),
+                            block.compressed.data());
+}
+
+void compressBlocks(std::vector<PendingBlock>& blocks, 
+                    size_t count, 
+                    size_t threads,
+                    const ThreadOptions& threadOptions) {
+  if (threads < 2 || count < 2) {
+    for (size_t i = 0; i < count; ++i) {
+      compressBlock(blocks[i]);
+    }
+    return;
+  }
+
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads && t < count; ++t) {
+    pool.emplace_back([&blocks, &threadOptions, count, threads, t] {
+      applyThreadOptions(threadOptions);
+      for (size_t i = t; i < count; i += threads) {
+        compressBlock(blocks[i]);
+      }
+    });
+  }
+
+  for (auto& thread: pool) {
+    thread.join();
+  }
+}
+
+/* Cuts the source into blocks following the marks */
+class BlockPlanner {
+public:
+  BlockPlanner(const BlockMarks& marks) :
+    m_marks(marks),
+    m_index(0),
+    m_timestamp(-1) {}
+
+  /* Size and first record timestamp of the block at offset */
+  size_t next(int64_t offset, int64_t* timestamp) {
+    while (m_index < m_marks.size() && m_marks[m_index].offset <= offset) {
+      m_timestamp = m_marks[m_index++].timestamp;
+    }
+    /* blocks starting in the middle of the record get its timestamp, that is
+       the lower bound of the block records' time */
+    *timestamp = m_timestamp;
+
+    if (m_index == m_marks.size())
+      return kArchiveBlockSize;
+
+    return (size_t)std::min<int64_t>(m_marks[m_index].offset - offset, kMaxBlockSize);
+  }
+
+private:
+  const BlockMarks& m_marks;
+  size_t m_index;
+  int64_t m_timestamp;
+};
+
+}
+
+int64_t writeArchive(FILE* in,
+                     const std::string& outName,
+                     const BlockMarks& marks,
+                     size_t threads,
+                     const ThreadOptions& threadOptions) {
+  using FilePtr = std::unique_ptr<FILE, int(*)(FILE*)>;
+  FilePtr out(fopen(outName.c_str(), "wb"), fclose);
+  if (!out)
+    throw std::runtime_error(sl::fmt("archive: open % failed", outName));
+
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<PendingBlock> pending(threads * kBlocksPerThread);
+  std::vector<ArchiveReader::Block> index;
+  BlockPlanner planner(marks);
+  int64_t inOffset = 0;
+  int64_t outOffset = sizeof(kMagic);
+  bool eof = false;
+
+  writeAll(out.get(), kMagic, sizeof(kMagic), outName);
+  while (!eof) {
+    size_t count = 0;
+    for (; count < pending.size(); ++count) {
+      auto& block = pending[count];
+      block.raw.resize(planner.next(inOffset, &block.timestamp));
+      block.raw.resize(fread(block.raw.data(), 1, block.raw.size(), in));
+      if (block.raw.empty()) {
+        eof = true;
+        break;
+      }
+      inOffset += block.raw.size();
+    }
+
+    if (ferror(in))
+      throw std::runtime_error(sl::fmt("archive: read failed while writing %", outName));
+
+    compressBlocks(pending, count, threads, threadOptions);
+
+    for (size_t i = 0; i < count; ++i) {
+      auto& block = pending[i];
+      const char* data = block.compressed.data();
+      uint32_t sizeField = (uint32_t)block.size;
+      if (block.size >= block.raw.size()) {
+        block.size = block.raw.size();
+        data = block.raw.data();
+        sizeField = (uint32_t)block.size | kStoredFlag;
+      }
+
+      char header[kBlockHeaderSize];
+      putU32(header, (uint32_t)block.raw.size());
+      putU32(header + 4, sizeField);
+      writeAll(out.get(), header, sizeof(header), outName);
+      writeAll(out.get(), data, block.size, outName);
+
+      index.push_back({outOffset, block.timestamp, (uint32_t)block.raw.size()});
+      outOffset += sizeof(header) + block.size;
+    }
+  }
+
+  std::vector<char> tail(index.size() * kIndexEntrySize + kTrailerSize);
+  char* p = tail.data();
+  for (const auto& block: index) {
+    putU64(p, (uint64_t)block.offset);
+    putU64(p + 8, (uint64_t)block.timestamp);
+    putU32(p + 16, block.rawSize);
+    p += kIndexEntrySize;
+  }
+  putU32(p, (uint32_t)index.size());
+  putU64(p + 4, (uint64_t)outOffset);
+  memcpy(p + 12, kIndexMagic, sizeof(kIndexMagic));
+  writeAll(out.get(), tail.data(), tail.size(), outName);
+
+  if (fflush(out.get()) != 0)
+    throw std::runtime_error(sl::fmt("archive: flush % failed", outName));
+
+  return outOffset + tail.size();
+}
+
+ArchiveReader::ArchiveReader(const std::string& fileName) :
+  m_fileName(fileName),
+  m_file(fopen(fileName.c_str(), "rb"), fclose)
+{
+  if (!m_file)
+    throw std::runtime_error(sl::fmt("archive: open % failed", fileName));
+
+  char magic[sizeof(kMagic)];
+  char trailer[kTrailerSize];
+  if (fread(magic, sizeof(magic), 1, m_file.get()) != 1 ||
+      memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      seek(m_file.get(), -(int64_t)kTrailerSize, SEEK_END) != 0 ||
+      fread(trailer, sizeof(trailer), 1, m_file.get()) != 1 ||
+      memcmp(trailer + 12, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+    throw std::runtime_error(sl::fmt("archive: % is not an archive", fileName));
+  }
+
+  uint32_t count = getU32(trailer);
+  std::vector<char> index(count * kIndexEntrySize);
+  if (seek(m_file.get(), (int64_t)getU64(trailer + 4), SEEK_SET) != 0 ||
+      (count != 0 && fread(index.data(), index.size(), 1, m_file.get()) != 1)) {
+    throw std::runtime_error(sl::fmt("archive: % index is corrupted", fileName));
+  }
+
+  for (const char* p = index.data(); p != index.data() + index.size(); p += kIndexEntrySize) {
+    m_blocks.push_back({(int64_t)getU64(p), (int64_t)getU64(p + 8), getU32(p + 16)});
+  }
+}
+
+std::string ArchiveReader::readBlock(size_t index) {
+  const auto& block = m_blocks.at(index);
+  char header[kBlockHeaderSize];
+
+  if (seek(m_file.get(), block.offset, SEEK_SET) != 0 ||
+      fread(header, sizeof(header), 1, m_file.get()) != 1 ||
+      getU32(header) != block.rawSize ||
+      block.rawSize > kMaxBlockSize) {
+    throw std::runtime_error(sl::fmt("archive: % block % is corrupted", m_fileName, index));
+  }
+
+  uint32_t sizeField = getU32(header + 4);
+  std::vector<char> data(sizeField & ~kStoredFlag);
+  if (!data.empty() && fread(data.data(), data.size(), 1, m_file.get()) != 1)
+    throw std::runtime_error(sl::fmt("archive: % is truncated", m_fileName));
+
+  if (sizeField & kStoredFlag)
+    return std::string(data.data(), data.size());
+
+  std::string result(block.rawSize, '\0');
+  if (!lz::decompress(data.data(), data.size(), &result[0], result.size()))
+    throw std::runtime_error(sl::fmt("archive: % block % is corrupted", m_fileName, index));
+
+  return result;
+}
+
+std::string ArchiveReader::readAll() {
+  std::string result;
+  for (size_t i = 0; i < m_blocks.size(); ++i) {
+    result += readBlock(i);
+  }
+
+  return result;
+}
+
+std::string ArchiveReader::read(int64_t from, int64_t to) {
+  std::string result;
+  for (size_t i = 0; i < m_blocks.size() && m_blocks[i].timestamp < to; ++i) {
+    bool last = i + 1 == m_blocks.size();
+    if (last || m_blocks[i + 1].timestamp == -1 || m_blocks[i + 1].timestamp > from)
+      result += readBlock(i);
+  }
+
+  return result;
+}
+
+bool ArchiveReader::isArchive(const std::string& fileName) {
+  FilePtr file(fopen(fileName.c_str(), "rb"), fclose);
+  char magic[sizeof(kMagic)];
+
+  return file &&
+         fread(magic, sizeof(magic), 1, file.get()) == 1 &&
+         memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <log/sink_options.h>
+
+namespace sl {
+namespace detail {
+
+/* Seekable archive of a rotated log file. Blocks are compressed
+   independently and the trailing index keeps each block's offset and the
+   time of its first record, so a time range can be read without
+   decompressing the whole file.
+
+   "SLZ2" block* index trailer
+   block:   u32 rawSize, u32 compressedSize (high bit - stored as is), data
+   index:   per block u64 offset, i64 firstTimestamp, u32 rawSize
+   trailer: u32 blockCount, u64 indexOffset, "SLZI"
+
+   Numbers are little endian, timestamps are microseconds since epoch, -1 if
+   unknown. */
+
+const size_t kArchiveBlockSize = 64 * 1024;
+
+/* Record started at offset of the source file at timestamp */
+struct BlockMark {
+  int64_t offset;
+  int64_t timestamp;
+
+  BlockMark(int64_t offset, int64_t timestamp) :
+    offset(offset),
+    timestamp(timestamp) {}
+};
+
+using BlockMarks = std::vector<BlockMark>;
+
+/* Archives the rest of the in stream to outName. Blocks start at marks (which
+   should be sorted by offset), regions without marks are cut into
+   kArchiveBlockSize blocks. Blocks are compressed by up to threads threads
+   (0 - one per core) started with threadOptions. Returns the archive
+   size. Throws on I/O errors. */
+int64_t writeArchive(FILE* in,
+                     const std::string& outName,
+                     const BlockMarks& marks,
+                     size_t threads = 1,
+                     const ThreadOptions& threadOptions = ThreadOptions());
+
+class ArchiveReader {
+  using FilePtr = std::unique_ptr<FILE, int(*)(FILE*)>;
+public:
+  struct Block {
+    int64_t offset;
+    int64_t timestamp;
+    uint32_t rawSize;
+  };
+
+  /* Reads the index, throws if fileName is not an archive */
+  ArchiveReader(const std::string& fileName);
+
+  const std::vector<Block>& blocks() const { return m_blocks; }
+  std::string readBlock(size_t index);
+  std::string readAll();
+  /* Decompresses only the blocks which may hold records with timestamps in
+     [from, to). Records outside the range at the edges are not cut off. */
+  std::string read(int64_t from, int64_t to);
+
+  static bool isArchive(const std::string& fileName);
+
+private:
+  std::string m_fileName;
+  FilePtr m_file;
+  std::vector<Block> m_blocks;
+};
+
+}
+}
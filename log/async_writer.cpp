@@ -0,0 +1,191 @@
+#include <log/async_writer.h>
+#include <log/thread_options.h>
+#include <log/utils.h>
+
+namespace sl {
+namespace detail {
+
+AsyncWriter::AsyncWriter(const AsyncOptions& options, 
+                         Write write, 
+                         Notice notice,
+                         const ThreadOptions& threadOptions)
+  : m_stopping(false),
+    m_writing(false),
+    m_waiter(options.waitStrategy),
+    m_queue(options.perThread ? nullptr : new RecordQueue(options, &m_waiter)),
+    m_staging(options.perThread ? new StagingBuffers(options) : nullptr),
+    m_write(std::move(write)),
+    m_notice(std::move(notice)),
+    m_sequenced(options.priorityQueueSize != 0 && !options.perThread),
+    m_sequence(0),
+    m_hasTasks(false),
+    m_tasksPosted(0),
+    m_tasksRun(0),
+    m_threadOptions(threadOptions)
+{
+  if (m_staging) {
+    m_thread = std::thread([this] { runStaging(); });
+  } else {
+    m_thread = std::thread([this] { runQueue(); });
+  }
+}
+
+AsyncWriter::~AsyncWriter() {
+  m_stopping = true;
+  m_waiter.notify();
+  if (m_queue) {
+    m_queue->stop();
+  } else {
+    m_staging->stop();
+  }
+
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+bool AsyncWriter::push(Record record) {
+  if (m_queue)
+    return m_queue->push(std::move(record));
+
+  auto result = m_staging->push(std::move(record));
+  m_waiter.notify();
+  return result;
+}
+
+uint64_t AsyncWriter::nextSequence() {
+  return m_sequenced ? ++m_sequence : 0;
+}
+
+void AsyncWriter::flush() {
+  if (m_queue) {
+    m_queue->waitDone();
+  } else {
+    m_staging->waitDone();
+  }
+}
+
+void AsyncWriter::call(Task task) {
+  flush();
+
+  std::unique_lock<std::mutex> lock(m_tasksMutex);
+  m_tasks.push_back(std::move(task));
+  auto id = ++m_tasksPosted;
+  m_hasTasks = true;
+  m_waiter.notify();
+  m_tasksDone.wait(lock, [this, id] { return m_tasksRun >= id; });
+}
+
+bool AsyncWriter::idle() const {
+  if (m_writing)
+    return false;
+  if (m_queue)
+    return m_queue->empty();
+
+  bool empty = true;
+  return m_staging->tryVisit([&empty](const Record&) { empty = false; }) && empty;
+}
+
+QueueStats AsyncWriter::stats() const {
+  return m_queue ? m_queue->stats() : m_staging->stats();
+}
+
+void AsyncWriter::reportDropped(uint64_t dropped) {
+  if (dropped == 0)
+    return;
+
+  try {
+    m_notice(dropped);
+  } catch (...) {
+  }
+}
+
+void AsyncWriter::runTasks() {
+  if (!m_hasTasks)
+    return;
+
+  std::vector<Task> tasks;
+  uint64_t posted;
+  {
+    std::lock_guard<std::mutex> lock(m_tasksMutex);
+    tasks.swap(m_tasks);
+    posted = m_tasksPosted;
+    m_hasTasks = false;
+  }
+
+  for (const auto& task: tasks) {
+    try {
+      task();
+    } catch (...) {
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_tasksMutex);
+  m_tasksRun = posted;
+  m_tasksDone.notify_all();
+}
+
+void AsyncWriter::runQueue() {
+  RecordBatch batch;
+  applyThreadOptions(m_threadOptions);
+
+  while (true) {
+    m_waiter.wait([this] { return !m_queue->empty() || m_hasTasks || m_stopping; });
+    runTasks();
+    m_writing = true;
+    if (!m_queue->tryPop(&batch)) {
+      m_writing = false;
+      if (m_stopping)
+        return;
+      continue;
+    }
+
+    /* Measured records are stamped once per batch, the time spent writing
+       the ones before them isn't queueing */
+    if (batch.front().queuedAt != 0) {
+      auto takenAt = ts::steadyNs();
+      for (auto& record: batch) {
+        record.takenAt = takenAt;
+      }
+    }
+
+    for (const auto& record: batch) {
+      try {
+        m_write(record);
+      } catch (...) {
+      }
+    }
+    m_writing = false;
+
+    reportDropped(m_queue->takeDropped());
+    m_queue->done(batch);
+  }
+}
+
+void AsyncWriter::runStaging() {
+  applyThreadOptions(m_threadOptions);
+  auto write = [this](const Record& record) {
+    try {
+      m_write(record);
+    } catch (...) {
+    }
+  };
+
+  while (true) {
+    /* read before draining, so the last round sees everything pushed */
+    bool stopping = m_stopping;
+    m_writing = true;
+    auto written = m_staging->drain(write);
+    m_writing = false;
+    reportDropped(m_staging->takeDropped());
+    runTasks();
+
+    if (written == 0) {
+      if (stopping)
+        return;
+      m_waiter.wait([this] { return m_staging->pending() || m_hasTasks || m_stopping; });
+    }
+  }
+}
+
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <log/record_queue.h>
+#include <log/staging_buffers.h>
+#include <log/waiter.h>
+
+namespace sl {
+namespace detail {
+
+/* Writes queued records on its own thread. Once the queue has drained
+   after an overload the number of dropped records is reported to the
+   notice callback, which should write it out synchronously. Depending on
+   AsyncOptions::perThread records come through a shared RecordQueue or
+   per thread StagingBuffers. */
+class AsyncWriter {
+public:
+  using Write = std::function<void(const Record&)>;
+  using Notice = std::function<void(uint64_t dropped)>;
+  using Task = std::function<void()>;
+
+  AsyncWriter(const AsyncOptions& options, 
+              Write write, 
+              Notice notice,
+              const ThreadOptions& threadOptions = ThreadOptions());
+  /* Writes what is queued and joins */
+  ~AsyncWriter();
+
+  bool push(Record record);
+  /* Sequence number for the next record's text, 0 if records aren't
+     numbered (no priority lane) */
+  uint64_t nextSequence();
+  /* Returns when the records pushed before the call are written */
+  void flush();
+  /* Runs task on the writer thread after the records pushed before the
+     call, so it doesn't interleave with the writes. Returns once it has
+     run, must not be called by the writer thread. */
+  void call(Task task);
+  QueueStats stats() const;
+  /* Times the writer thread has been woken up from parking */
+  uint64_t wakeups() const { return m_waiter.wakeups(); }
+
+  /* For the fatal signal handler, none of these take locks. The writer
+     is idle if nothing is queued or being written. */
+  bool idle() const;
+  bool isWriterThread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+  /* Visits the records which are queued, but not taken by the writer.
+     Returns false if the queue is being changed. */
+  template<typename Visit>
+  bool tryVisit(Visit visit) const {
+    return m_queue ? m_queue->tryVisit(visit) : m_staging->tryVisit(visit);
+  }
+
+private:
+  void runQueue();
+  void runStaging();
+  void reportDropped(uint64_t dropped);
+  void runTasks();
+
+private:
+  std::atomic<bool> m_stopping;
+  std::atomic<bool> m_writing;
+  Waiter m_waiter;
+  std::unique_ptr<RecordQueue> m_queue;
+  std::unique_ptr<StagingBuffers> m_staging;
+  Write m_write;
+  Notice m_notice;
+  bool m_sequenced;
+  std::atomic<uint64_t> m_sequence;
+  std::mutex m_tasksMutex;
+  std::condition_variable m_tasksDone;
+  std::vector<Task> m_tasks;
+  std::atomic<bool> m_hasTasks;
+  uint64_t m_tasksPosted;
+  uint64_t m_tasksRun;
+  ThreadOptions m_threadOptions;
+  std::thread m_thread;
+};
+
+using AsyncWriterPtr = std::unique_ptr<AsyncWriter>;
+
+}
+}
@@ -0,0 +1,50 @@
+#include <stdexcept>
+#include <log/backtrace.h>
+
+namespace sl {
+namespace detail {
+
+Backtrace::Backtrace(const BacktraceOptions& options) :
+  m_options(options),
+  m_entries(options.size),
+  m_next(0),
+  m_size(0) {
+  if (options.size == 0)
+    throw std::runtime_error("backtrace: size should be positive");
+}
+
+void Backtrace::push(int64_t timestamp, Level level, const std::string& message) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_entries[m_next];
+  entry.timestamp = timestamp;
+  entry.level = level;
+  entry.threadId = std::this_thread::get_id();
+  entry.message.assign(message);
+
+  m_next = (m_next + 1) % m_entries.size();
+  if (m_size < m_entries.size())
+    ++m_size;
+}
+
+std::vector<Backtrace::Entry> Backtrace::take() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<Entry> result;
+  result.reserve(m_size);
+  size_t first = (m_next + m_entries.size() - m_size) % m_entries.size();
+  for (size_t i = 0; i < m_size; ++i) {
+    auto& entry = m_entries[(first + i) % m_entries.size()];
+    result.push_back(entry);
+    entry.message.clear();
+  }
+
+  m_size = 0;
+  return result;
+}
+
+size_t Backtrace::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_size;
+}
+
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <log/level.h>
+#include <log/sink_options.h>
+
+namespace sl {
+namespace detail {
+
+/* Ring of the last captured records of a sink. Slots are reused, so once
+   the ring is full a capture copies the message into an existing buffer
+   instead of allocating. */
+class Backtrace {
+public:
+  struct Entry {
+    int64_t timestamp;
+    Level level;
+    std::thread::id threadId;
+    std::string message;
+
+    Entry() : timestamp(0), level(Level::debug) {}
+  };
+
+  explicit Backtrace(const BacktraceOptions& options);
+
+  const BacktraceOptions& options() const { return m_options; }
+  bool captures(Level level) const { return (int)level >= (int)m_options.level; }
+
+  void push(int64_t timestamp, Level level, const std::string& message);
+  /* Copies the entries out oldest first and empties the ring, keeping the
+     slot buffers */
+  std::vector<Entry> take();
+  size_t size() const;
+
+private:
+  const BacktraceOptions m_options;
+  mutable std::mutex m_mutex;
+  std::vector<Entry> m_entries;
+  size_t m_next;
+  size_t m_size;
+};
+
+using BacktracePtr = std::unique_ptr<Backtrace>;
+
+}
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <log/call_site.h>
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+/* Sites are only ever added, at the head */
+std::atomic<CallSite*> g_sites(nullptr);
+
+template<typename Visit>
+void forEachSite(Visit visit) {
+  for (auto site = g_sites.load(std::memory_order_acquire); site != nullptr;
+       site = const_cast<CallSite*>(site->next())) {
+    visit(*site);
+  }
+}
+
+}
+
+CallSiteStats CallSite::stats() const {
+  CallSiteStats result;
+  result.file = m_file;
+  result.line = m_line;
+  result.format = m_format ? m_format : "";
+  result.hits = m_hits.load(std::memory_order_relaxed);
+  result.bytes = m_bytes.load(std::memory_order_relaxed);
+  result.filtered = m_filtered.load(std::memory_order_relaxed);
+  return result;
+}
+
+void CallSite::reset() {
+  m_hits.store(0, std::memory_order_relaxed);
+  m_bytes.store(0, std::memory_order_relaxed);
+  m_filtered.store(0, std::memory_order_relaxed);
+}
+
+void CallSite::registerSite() {
+  if (m_registered.exchange(true, std::memory_order_acq_rel))
+    return;
+
+  auto head = g_sites.load(std::memory_order_relaxed);
+  do {
+    m_next.store(head, std::memory_order_relaxed);
+  } while (!g_sites.compare_exchange_weak(head, this, 
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
+
+}
+
+std::vector<CallSiteStats> topCallSites(size_t n) {
+  std::vector<CallSiteStats> result;
+  detail::forEachSite([&result](const detail::CallSite& site) { 
+    result.push_back(site.stats()); 
+  });
+
+  std::sort(result.begin(), result.end(), 
+            [](const CallSiteStats& l, const CallSiteStats& r) {
+              return l.bytes != r.bytes ? l.bytes > r.bytes : l.hits > r.hits;
+            });
+  if (n != 0 && result.size() > n)
+    result.resize(n);
+  return result;
+}
+
+void dumpTopCallSites(std::ostream& out, size_t n) {
+  for (const auto& site: topCallSites(n)) {
+    out << std::dec << site.bytes << " " << site.hits << " " << site.filtered << " "
+        << site.file << ":" << site.line << " " << site.format << std::endl;
+  }
+}
+
+void resetCallSites() {
+  detail::forEachSite([](detail::CallSite& site) { site.reset(); });
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sl {
+
+struct CallSiteStats {
+  std::string file;
+  int line;
+  std::string format;
+  uint64_t hits;     /* records logged */
+  uint64_t bytes;    /* written by them, records kept only in a backtrace or
+                        a flight recorder count as 0 */
+  uint64_t filtered; /* calls skipped by the level check */
+};
+
+/* The LOG and LOG_S statements compiled with SL_PROFILE_CALL_SITES defined,
+   by bytes (then hits) descending. n = 0 - all of them. Sites which have
+   never been reached are not listed. */
+std::vector<CallSiteStats> topCallSites(size_t n = 0);
+/* "bytes hits filtered file:line format" lines */
+void dumpTopCallSites(std::ostream& out, size_t n = 0);
+void resetCallSites();
+
+namespace detail {
+
+/* Counters of one LOG statement, a function local static registered in
+   a global list on first use. Relaxed atomics keep the cost down to two
+   uncontended additions per call for a site used by one thread. */
+class CallSite {
+public:
+  constexpr CallSite(const char* file, int line, const char* format) : 
+    m_file(file),
+    m_line(line),
+    m_format(format),
+    m_hits(0),
+    m_bytes(0),
+    m_filtered(0),
+    m_next(nullptr),
+    m_registered(false) {}
+
+  CallSite(const CallSite&) = delete;
+  CallSite& operator=(const CallSite&) = delete;
+
+  void hit(size_t bytes) {
+    registerOnce();
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void filtered() {
+    registerOnce();
+    m_filtered.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  CallSiteStats stats() const;
+  void reset();
+  const CallSite* next() const { return m_next.load(std::memory_order_acquire); }
+
+private:
+  void registerOnce() {
+    if (!m_registered.load(std::memory_order_relaxed))
+      registerSite();
+  }
+
+  void registerSite();
+
+private:
+  const char* m_file;
+  int m_line;
+  const char* m_format;
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_bytes;
+  std::atomic<uint64_t> m_filtered;
+  std::atomic<CallSite*> m_next;
+  std::atomic<bool> m_registered;
+};
+
+}
+}
@@ -0,0 +1,262 @@
+#include <string.h>
+#include <errno.h>
+#include <atomic>
+#include <log/crash_handler.h>
+#include <log/utils.h>
+
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+  #define SL_CRASH_HANDLER
+  #include <signal.h>
+  #include <time.h>
+  #include <unistd.h>
+  #include <pthread.h>
+#endif
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+const int kMaxTargets = 256;
+std::atomic<CrashTarget*> g_targets[kMaxTargets];
+
+}
+
+CrashTarget::CrashTarget(LogFilesManager* files, 
+                         AsyncWriter* writer, 
+                         FlightRecorder* recorder) :
+  files(files),
+  writer(writer),
+  recorder(recorder),
+  m_slot(-1)
+{
+  /* Sinks past the table size are not flushed on crashes */
+  for (int i = 0; i < kMaxTargets && m_slot == -1; ++i) {
+    CrashTarget* expected = nullptr;
+    if (g_targets[i].compare_exchange_strong(expected, this))
+      m_slot = i;
+  }
+}
+
+CrashTarget::~CrashTarget() {
+  if (m_slot != -1)
+    g_targets[m_slot] = nullptr;
+}
+
+}
+
+#if defined (SL_CRASH_HANDLER)
+
+namespace detail {
+
+namespace {
+
+const int kSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+const int kSignalCount = sizeof(kSignals) / sizeof(kSignals[0]);
+const size_t kAltStackSize = 64 * 1024;
+
+struct sigaction g_previous[kSignalCount];
+std::atomic<bool> g_installed(false);
+std::atomic<bool> g_handling(false);
+std::atomic<int64_t> g_drainTimeout(0);
+/* Taken at the install, localtime() is not async-signal-safe */
+std::atomic<int64_t> g_utcOffset(0);
+
+/* Fixed size text, formatted without allocation */
+class Text {
+public:
+  Text() : m_size(0) {}
+
+  void append(const char* s) {
+    while (*s != '\0' && m_size < sizeof(m_data)) {
+      m_data[m_size++] = *s++;
+    }
+  }
+
+  void append(uint64_t value, int width = 1, unsigned base = 10) {
+    char digits[32];
+    int count = 0;
+    do {
+      digits[count++] = "0123456789abcdef"[value % base];
+      value /= base;
+    } while (value != 0 && count < (int)sizeof(digits));
+    for (; width > count; --width) {
+      append("0");
+    }
+    while (count != 0 && m_size < sizeof(m_data)) {
+      m_data[m_size++] = digits[--count];
+    }
+  }
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  char m_data[256];
+  size_t m_size;
+};
+
+void writeAll(int fd, const char* data, size_t size) {
+  while (size != 0) {
+    auto written = ::write(fd, data, size);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return;
+    data += written;
+    size -= (size_t)written;
+  }
+}
+
+int64_t monotonicMs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+const char* signalName(int signal) {
+  switch (signal) {
+    case SIGSEGV: return "SIGSEGV";
+    case SIGBUS:  return "SIGBUS";
+    case SIGFPE:  return "SIGFPE";
+    case SIGILL:  return "SIGILL";
+    case SIGABRT: return "SIGABRT";
+    default:      return "signal";
+  }
+}
+
+/* Local time in the default format, the time format set to the logger
+   isn't used here */
+void appendTime(Text* text) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  int64_t seconds = (int64_t)now.tv_sec + g_utcOffset;
+  int64_t days = seconds / 86400;
+  int64_t daySeconds = seconds % 86400;
+  if (daySeconds < 0) {
+    daySeconds += 86400;
+    --days;
+  }
+
+  /* civil from days */
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t dayOfEra = days - era * 146097;
+  int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int64_t mp = (5 * dayOfYear + 2) / 153;
+  int64_t day = dayOfYear - (153 * mp + 2) / 5 + 1;
+  int64_t month = mp < 10 ? mp + 3 : mp - 9;
+  int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+  text->append((uint64_t)year, 4);
+  text->append("-");
+  text->append((uint64_t)month, 2);
+  text->append("-");
+  text->append((uint64_t)day, 2);
+  text->append(" ");
+  text->append((uint64_t)(daySeconds / 3600), 2);
+  text->append(":");
+  text->append((uint64_t)(daySeconds % 3600 / 60), 2);
+  text->append(":");
+  text->append((uint64_t)(daySeconds % 60), 2);
+  text->append(".");
+  text->append((uint64_t)(now.tv_nsec / 1000000), 3);
+  text->append(" ");
+}
+
+void handleSignal(int signal) {
+  if (!g_handling.exchange(true))
+    emergencyFlush(signal, g_drainTimeout);
+
+  for (int i = 0; i < kSignalCount; ++i) {
+    if (kSignals[i] == signal)
+      sigaction(signal, &g_previous[i], nullptr);
+  }
+  /* delivered to the previous handler once this one returns */
+  raise(signal);
+}
+
+}
+
+void emergencyFlush(int signal, int64_t drainTimeout) {
+  int64_t deadline = monotonicMs() + drainTimeout;
+  for (auto& slot: g_targets) {
+    auto target = slot.load();
+    if (target == nullptr || target->writer == nullptr || target->writer->isWriterThread())
+      continue;
+
+    while (!target->writer->idle() && monotonicMs() < deadline) {
+      struct timespec pause = {0, 1000000};
+      nanosleep(&pause, nullptr);
+    }
+  }
+
+  Text record;
+  appendTime(&record);
+  record.append("CRITICAL ");
+  record.append((uint64_t)pthread_self(), 1, 16);
+  record.append(" sl: fatal signal ");
+  record.append((uint64_t)signal);
+  record.append(" (");
+  record.append(signalName(signal));
+  record.append(")\n\n");
+
+  for (auto& slot: g_targets) {
+    auto target = slot.load();
+    if (target == nullptr)
+      continue;
+
+    int fd = target->files->activeFd();
+    if (fd >= 0 && target->writer != nullptr) {
+      target->writer->tryVisit([fd](const Record& queued) {
+        writeAll(fd, queued.data.data(), queued.data.size());
+      });
+    }
+    if (target->recorder != nullptr)
+      target->recorder->write(record.data(), record.size());
+    if (fd >= 0)
+      writeAll(fd, record.data(), record.size());
+  }
+}
+
+}
+
+void installCrashHandler(int64_t drainTimeout) {
+  using namespace detail;
+
+  g_drainTimeout = drainTimeout;
+  g_utcOffset = ts::localTime(ts::now() / 1000000).tm_gmtoff;
+  if (g_installed.exchange(true))
+    return;
+
+  /* Stack overflows of the calling thread are handled on this stack */
+  stack_t altStack;
+  altStack.ss_sp = new char[kAltStackSize];
+  altStack.ss_size = kAltStackSize;
+  altStack.ss_flags = 0;
+  sigaltstack(&altStack, nullptr);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleSignal;
+  action.sa_flags = SA_ONSTACK;
+  sigemptyset(&action.sa_mask);
+  for (int i = 0; i < kSignalCount; ++i) {
+    sigaction(kSignals[i], &action, &g_previous[i]);
+  }
+}
+
+#else
+
+namespace detail {
+
+void emergencyFlush(int /*signal*/, int64_t /*drainTimeout*/) {}
+
+}
+
+void installCrashHandler(int64_t /*drainTimeout*/) {}
+
+#endif
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <log/log_files_manager.h>
+#include <log/async_writer.h>
+#include <log/flight_recorder.h>
+
+namespace sl {
+
+/* Installs handlers of SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT which
+   write what the sinks still hold and a "fatal signal" record, then pass the
+   signal on to the handlers installed before. Writer threads get up to
+   drainTimeout ms to empty their queues, the records left are written
+   directly then (possibly twice if a writer is just slow). POSIX only, does
+   nothing elsewhere. */
+void installCrashHandler(int64_t drainTimeout = 1000);
+
+namespace detail {
+
+/* A sink as seen by the fatal signal handler, which finds it in a fixed
+   size table without locks. Registered for its lifetime; the pointees
+   should outlive it. */
+class CrashTarget {
+public:
+  CrashTarget(LogFilesManager* files, AsyncWriter* writer, FlightRecorder* recorder);
+  ~CrashTarget();
+
+  CrashTarget(const CrashTarget&) = delete;
+  CrashTarget& operator=(const CrashTarget&) = delete;
+
+  LogFilesManager* const files;
+  AsyncWriter* const writer;
+  FlightRecorder* const recorder;
+
+private:
+  int m_slot;
+};
+
+using CrashTargetPtr = std::unique_ptr<CrashTarget>;
+
+/* What the handler does, async-signal-safe: only write(2) on the open
+   descriptors, no allocation and no waiting for locks */
+void emergencyFlush(int signal, int64_t drainTimeout);
+
+}
+}
@@ -10,6 +10,8 @@
 
 #if defined (_WIN32)
   #include <windows.h>
+  #include <sys/types.h>
+  #include <sys/stat.h>
 #endif
 namespace sl {
 namespace detail {
@@ -24,6 +26,14 @@ int64_t getFileSizeUnix(const std::string& fullPath) {
   return st.st_size;
 }
 
+int64_t getLastModifiedUnix(const std::string& fullPath) {
+  struct stat st;
+  if (stat(fullPath.data(), &st) != 0)
+    throw std::runtime_error(
+        sl::fmt("Get modification time failed for the file %", fullPath));
+  return st.st_mtime;
+}
+
 #elif defined (_WIN32)
 
 int64_t getFileSizeWin(const std::string& fullPath) {
@@ -42,13 +52,25 @@ int64_t getFileSizeWin(const std::string& fullPath) {
   CloseHandle(hFile);
   return result.QuadPart;
 }
+
+int64_t getLastModifiedWin(const std::string& fullPath) {
+  struct _stat64 st;
+  if (_stat64(fullPath.c_str(), &st) != 0)
+    throw std::runtime_error(sl::fmt("Get modification time failed for the file %",
+                                     fullPath));
+  return st.st_mtime;
+}
 #endif
 
+FileEntryFactory::FileEntryFactory(int64_t writeBackChunk) :
+  m_writeBackChunk(writeBackChunk) {
+}
+
 FileEntryPtr FileEntryFactory::create(const std::string& path, 
                                       const std::string& baseName,
                                       size_t index) {
   std::string fullFileName = getFullFileName(path, baseName, index);
-  return FileEntryPtr(new FileEntry(fullFileName));
+  return FileEntryPtr(new FileEntry(fullFileName, m_writeBackChunk));
 }
 
 std::string FileEntryFactory::getFullFileName(const std::string& path,
@@ -71,16 +93,17 @@ FileEntryList FileEntryFactory::getExistent(const std::string& path,
   dir.forEachEntry([&baseName, &path, &result, this](const fs::Dir::Entry& entry) {
     if (entry.type == fs::Dir::Type::file &&
         fs::globMatch(entry.name.c_str(), (baseName + '*').c_str())) {
-      result.push_back(FileEntryPtr(new FileEntry(str::join(fs::join(path, baseName),
-                                                            kLogFileExtension))));
+      result.push_back(FileEntryPtr(new FileEntry(fs::join(path, entry.name), 
+                                                  m_writeBackChunk)));
     }
   });
 
   return result;
 }
 
-FileEntry::FileEntry(const std::string& fullPath) : 
-    m_fullPath(fullPath) {
+FileEntry::FileEntry(const std::string& fullPath, int64_t writeBackChunk) : 
+    m_fullPath(fullPath),
+    m_writeBackChunk(writeBackChunk) {
 }
 
 void FileEntry::remove() {
@@ -110,6 +133,14 @@ int64_t FileEntry::size() const {
 #endif
 }
 
+int64_t FileEntry::lastModified() const {
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+  return getLastModifiedUnix(m_fullPath);
+#elif defined (_WIN32)
+  return getLastModifiedWin(m_fullPath);
+#endif
+}
+
 bool FileEntry::exists() const {
   struct stat st; 
   if (stat(m_fullPath.c_str(), &st) == 0)
@@ -118,7 +149,7 @@ bool FileEntry::exists() const {
 }
 
 FileStreamPtr FileEntry::open() {
-  return FileStreamPtr(new FileStream(m_fullPath));
+  return FileStreamPtr(new FileStream(m_fullPath, m_writeBackChunk));
 }
 
 } // detail
@@ -10,6 +10,7 @@ namespace sl {
 namespace detail {
 
 const std::string kLogFileExtension = ".log";
+const std::string kTmpFileExtension = ".tmp";
 
 class IFileEntry {
 public:
@@ -18,6 +19,8 @@ public:
   virtual void rename(const std::string& newName) = 0;
   virtual std::string name() const = 0;
   virtual int64_t size() const = 0;
+  /* Seconds since epoch */
+  virtual int64_t lastModified() const = 0;
   virtual bool exists() const = 0;
   virtual FileStreamPtr open() = 0;
 };
@@ -26,17 +29,19 @@ using FileEntryPtr = std::unique_ptr<IFileEntry>;
 
 class FileEntry : public IFileEntry {
 public:
-  FileEntry(const std::string& fileName);
+  FileEntry(const std::string& fileName, int64_t writeBackChunk = 0);
 
   virtual void remove() override;
   virtual void rename(const std::string& newName) override;
   virtual std::string name() const override;
   virtual int64_t size() const override;
+  virtual int64_t lastModified() const override;
   virtual bool exists() const override;
   virtual FileStreamPtr open() override;
 
 private:
   std::string m_fullPath;
+  int64_t m_writeBackChunk;
 };
 
 using FileEntryList = std::deque<FileEntryPtr>;
@@ -52,6 +57,9 @@ public:
 
 class FileEntryFactory : public IFileEntryFactory {
 public:
+  /* Entries open streams with the writeBackChunk, see FileStream */
+  FileEntryFactory(int64_t writeBackChunk = 0);
+
   virtual FileEntryPtr create(const std::string& path, 
                               const std::string& baseName,
                               size_t index = 0) override;
@@ -62,6 +70,9 @@ private:
   static std::string getFullFileName(const std::string& path,
                                      const std::string& baseName,
                                      size_t index);
+
+private:
+  int64_t m_writeBackChunk;
 };
 
 using FileEntryFactoryPtr = std::unique_ptr<IFileEntryFactory>;
@@ -1,38 +1,152 @@
 #include <stdio.h>
 #include <algorithm>
+#include <tuple>
+#include <vector>
 #include <log/file_entry_catalog.h>
 #include <log/utils.h>
 #include <log/format.h>
+#include <log/lz.h>
 
 namespace sl {
 namespace detail {
 
+namespace {
+
+const char* const kPeriodFormat = "%Y%m%d-%H%M%S";
+
+bool parseNumber(const std::string& s, size_t from, size_t to, int64_t* result) {
+  if (from >= to)
+    return false;
+
+  *result = 0;
+  for (size_t i = from; i < to; ++i) {
+    if (s[i] < '0' || s[i] > '9')
+      return false;
+    *result = *result * 10 + (s[i] - '0');
+  }
+
+  return true;
+}
+
+using EntryOrder = std::tuple<int, int64_t, int64_t, std::string>;
+
+/* Name without the directory, base name and extensions */
+std::string nameSuffix(const std::string& name, size_t prefixSize) {
+  auto suffix = name.substr(prefixSize);
+  if (str::endsWith(suffix, lz::kCompressedExtension))
+    suffix.resize(suffix.size() - lz::kCompressedExtension.size());
+  if (str::endsWith(suffix, kLogFileExtension))
+    suffix.resize(suffix.size() - kLogFileExtension.size());
+
+  return suffix;
+}
+
+/* The active file goes first, then period files newest first, then indexed
+   files in index order. suffix is the part between baseName and extension */
+EntryOrder entryOrder(const std::string& suffix) {
+  int64_t date, time, seq = 0;
+
+  if (suffix.empty())
+    return EntryOrder(0, 0, 0, suffix);
+
+  if (suffix.size() >= 16 && suffix[0] == '-' && suffix[9] == '-' &&
+      parseNumber(suffix, 1, 9, &date) && parseNumber(suffix, 10, 16, &time) &&
+      (suffix.size() == 16 ||
+       (suffix[16] == '_' && parseNumber(suffix, 17, suffix.size(), &seq)))) {
+    return EntryOrder(1, -(date * 1000000 + time), -seq, suffix);
+  }
+
+  if (parseNumber(suffix, 0, suffix.size(), &seq))
+    return EntryOrder(2, seq, 0, suffix);
+
+  return EntryOrder(3, 0, 0, suffix);
+}
+
+}
+
 FileEntryCatalog::FileEntryCatalog(IFileEntryFactory* entryFactory, 
                    const std::string& path, 
                    const std::string& baseName)
   : m_factory(entryFactory),
     m_entries(m_factory->getExistent(path, baseName)),
     m_path(path),
-    m_baseName(baseName) 
+    m_baseName(baseName),
+    m_rotatedBytes(0),
+    m_nextId(0)
 {
-  if (m_entries.empty()) {
+  removeTemporary();
+  sortEntries();
+
+  if (m_entries.empty() || 
+      m_entries[0]->name() != str::join(fs::join(m_path, m_baseName), 
+                                        kLogFileExtension)) {
     addDefault();
   }
 
-  sortEntries();
+  loadInfo();
+}
+
+void FileEntryCatalog::loadInfo() {
+  m_info.clear();
+  m_info.emplace_back(m_nextId++, 0, 0);
+  for (size_t i = 1; i < m_entries.size(); ++i) {
+    m_info.emplace_back(m_nextId++, 
+                        m_entries[i]->size(), 
+                        m_entries[i]->lastModified());
+    m_rotatedBytes += m_info.back().size;
+  }
+}
+
+/* Leftovers of interrupted compression */
+void FileEntryCatalog::removeTemporary() {
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (str::endsWith((*it)->name(), kTmpFileExtension)) {
+      (*it)->remove();
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
 void FileEntryCatalog::sortEntries() {
-  std::sort(m_entries.begin(), m_entries.end(), 
-            [](const FileEntryPtr& lhs, const FileEntryPtr& rhs) {
-              return lhs->name() < rhs->name();
+  const size_t prefixSize = fs::join(m_path, m_baseName).size();
+  std::vector<std::pair<EntryOrder, FileEntryPtr>> ordered;
+
+  for (auto& entry: m_entries) {
+    auto order = entryOrder(nameSuffix(entry->name(), prefixSize));
+    ordered.emplace_back(order, std::move(entry));
+  }
+
+  std::sort(ordered.begin(), ordered.end(), 
+            [](const std::pair<EntryOrder, FileEntryPtr>& lhs, 
+               const std::pair<EntryOrder, FileEntryPtr>& rhs) {
+              return lhs.first < rhs.first;
             });
+
+  m_entries.clear();
+  for (auto& entry: ordered) {
+    m_entries.push_back(std::move(entry.second));
+  }
 }
 
 void FileEntryCatalog::addDefault() {
   m_entries.emplace_front(m_factory->create(m_path, m_baseName));
 }
 
+void FileEntryCatalog::closeFirst() {
+  m_info[0].size = first().size();
+  m_info[0].lastModified = first().lastModified();
+  m_rotatedBytes += m_info[0].size;
+  m_info.emplace_front(m_nextId++, 0, 0);
+}
+
+void FileEntryCatalog::popBack() {
+  m_rotatedBytes -= m_info.back().size;
+  m_entries.pop_back();
+  m_info.pop_back();
+}
+
 IFileEntry& FileEntryCatalog::first() {
   if (m_entries.empty()) {
     throw std::runtime_error(sl::fmt("%: no entries", __FUNCTION__));
@@ -42,6 +156,7 @@ IFileEntry& FileEntryCatalog::first() {
 }
 
 void FileEntryCatalog::rotate() {
+  closeFirst();
   for (int i = m_entries.size() - 1; i >= 0 ; --i) {
     this->rename(i);
   }
@@ -49,10 +164,43 @@ void FileEntryCatalog::rotate() {
   addDefault();
 }
 
+void FileEntryCatalog::rotate(int64_t periodStart) {
+  closeFirst();
+  first().rename(periodFileName(periodStart));
+  addDefault();
+}
+
+std::string FileEntryCatalog::periodFileName(int64_t periodStart) const {
+  auto prefix = str::join(fs::join(m_path, m_baseName), "-", 
+                          ts::format(periodStart, kPeriodFormat));
+  int64_t seq = 0;
+
+  /* Several files of the same period (size limit hit) get increasing
+     sequence numbers. The newest one, if any, is right after the active. */
+  if (m_entries.size() > 1) {
+    auto newest = m_entries[1]->name();
+    if (newest.compare(0, prefix.size(), prefix) == 0) {
+      auto tail = nameSuffix(newest, prefix.size());
+      if (tail.empty()) {
+        seq = 1;
+      } else if (tail[0] == '_' && parseNumber(tail, 1, tail.size(), &seq)) {
+        ++seq;
+      }
+    }
+  }
+
+  if (seq == 0)
+    return str::join(prefix, kLogFileExtension);
+
+  return str::join(prefix, "_", std::to_string(seq), kLogFileExtension);
+}
+
 void FileEntryCatalog::rename(size_t index) {
   std::string newName = str::join(fs::join(m_path, m_baseName), 
                                   std::to_string(index + 1), 
                                   kLogFileExtension);
+  if (str::endsWith(m_entries[index]->name(), lz::kCompressedExtension))
+    newName += lz::kCompressedExtension;
   m_entries[index]->rename(newName);
 }
 
@@ -61,16 +209,87 @@ int64_t FileEntryCatalog::removeLast() {
     throw std::runtime_error(sl::fmt("%: no entries", __FUNCTION__));
   }
   
-  auto result = m_entries.back()->size();
+  if (m_entries.size() == 1) {
+    auto result = m_entries.back()->size();
+    m_entries.back()->remove();
+    return result;
+  }
+
+  auto result = m_info.back().size;
   m_entries.back()->remove(); 
+  popBack();
 
-  if (m_entries.size() > 1) {
-    m_entries.pop_back();
+  return result;
+}
+
+int64_t FileEntryCatalog::removeExpired(int64_t now, 
+                                        int64_t maxAge, 
+                                        size_t maxFiles) {
+  int64_t result = 0;
+
+  while (m_entries.size() > 1) {
+    bool expired = (maxFiles != 0 && m_entries.size() > maxFiles) ||
+                   (maxAge != 0 && m_info.back().lastModified + maxAge <= now);
+    if (!expired)
+      break;
+
+    try {
+      m_entries.back()->remove();
+    } catch (const std::exception&) {
+      if (m_entries.back()->exists())
+        throw;
+    }
+
+    result += m_info.back().size;
+    popBack();
+  }
+
+  return result;
+}
+
+int64_t FileEntryCatalog::oldestTime() const {
+  if (m_entries.size() < 2)
+    return -1;
+
+  return m_info.back().lastModified;
+}
+
+std::vector<uint64_t> FileEntryCatalog::rotatedIds() const {
+  std::vector<uint64_t> result;
+  for (size_t i = 1; i < m_info.size(); ++i) {
+    result.push_back(m_info[i].id);
   }
 
   return result;
 }
 
+int FileEntryCatalog::indexOf(uint64_t id) const {
+  /* Recently rotated entries are the ones looked for the most */
+  for (size_t i = 1; i < m_info.size(); ++i) {
+    if (m_info[i].id == id)
+      return (int)i;
+  }
+
+  return -1;
+}
+
+IFileEntry* FileEntryCatalog::findRotated(uint64_t id) {
+  auto index = indexOf(id);
+  if (index == -1)
+    return nullptr;
+
+  return m_entries[index].get();
+}
+
+void FileEntryCatalog::setRotatedSize(uint64_t id, int64_t size) {
+  auto index = indexOf(id);
+  if (index == -1)
+    return;
+
+  m_rotatedBytes += size - m_info[index].size;
+  m_info[index].size = size;
+}
+
 std::string FileEntryCatalog::baseName() const {
   return m_baseName;
 }
@@ -84,12 +303,10 @@ bool FileEntryCatalog::empty() const {
 }
 
 int64_t FileEntryCatalog::totalBytes() const {
-  int64_t result = 0;
-  for (size_t i = 0; i < m_entries.size(); ++i) {
-    result += m_entries[i]->size();
-  }
+  if (m_entries.empty())
+    return 0;
 
-  return result;
+  return m_rotatedBytes + m_entries[0]->size();
 }
 
 }
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <log/file_entry.h>
 
 namespace sl {
@@ -13,8 +14,27 @@ public:
                    const std::string& path, 
                    const std::string& baseName);
   IFileEntry& first();
+  /* Shifts rotated files' indices, the active file becomes <baseName>1 */
   void rotate();
+  /* Renames the active file to <baseName>-<periodStart>[_<seq>], others
+     are left untouched */
+  void rotate(int64_t periodStart);
   int64_t removeLast();
+  /* Removes rotated files, oldest first, while they are older than maxAge
+     seconds or there are more than maxFiles entries (0 - no limit). Only the
+     cached metadata is consulted. Returns the number of bytes removed. */
+  int64_t removeExpired(int64_t now, int64_t maxAge, size_t maxFiles);
+  /* Modification time of the oldest rotated file, -1 if there are none */
+  int64_t oldestTime() const;
+
+  /* Rotated entries are also addressed by ids which survive renames and
+     are never reused. */
+  std::vector<uint64_t> rotatedIds() const;
+  /* nullptr if the entry has been removed */
+  IFileEntry* findRotated(uint64_t id);
+  /* Updates the cached size after the entry content has been replaced */
+  void setRotatedSize(uint64_t id, int64_t size);
+
   std::string baseName() const;
   size_t size() const;
   bool empty() const;
@@ -24,15 +44,38 @@ protected:
   const FileEntryList& entries() const { return m_entries; }
 
 private:
+  /* Cached metadata of the rotated files, the active one keeps growing and
+     is asked directly */
+  struct EntryInfo {
+    uint64_t id;
+    int64_t size;
+    int64_t lastModified;
+
+    EntryInfo(uint64_t id, int64_t size, int64_t lastModified) : 
+      id(id),
+      size(size), 
+      lastModified(lastModified) {}
+  };
+
+private:
+  void removeTemporary();
   void sortEntries();
+  void loadInfo();
+  int indexOf(uint64_t id) const;
+  void closeFirst();
+  void popBack();
   void addDefault();
   void rename(size_t index);
+  std::string periodFileName(int64_t periodStart) const;
 
 private:
   IFileEntryFactory* m_factory;
   FileEntryList m_entries;
   std::string m_path;
   std::string m_baseName;
+  std::deque<EntryInfo> m_info;
+  int64_t m_rotatedBytes;
+  uint64_t m_nextId;
 };
 
 using FileEntryCatalogPtr = std::unique_ptr<FileEntryCatalog>;
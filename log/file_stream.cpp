@@ -1,13 +1,29 @@
 #include <stdio.h>
+#include <errno.h>
+#include <stdexcept>
 #include <log/file_stream.h>
 #include <log/format.h>
 
+#if defined (__linux__)
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#elif defined (_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
 namespace sl {
 namespace detail {
 
-FileStream::FileStream(const std::string& fileName) 
+FileStream::FileStream(const std::string& fileName, int64_t writeBackChunk) 
   : m_fileName(fileName),
-    m_stream(nullptr) 
+    m_stream(nullptr),
+    m_writeBackChunk(writeBackChunk),
+    m_offset(0),
+    m_writeBackStart(0),
+    m_writeBackEnd(0)
 {
   open();
 }
@@ -33,27 +49,106 @@ void FileStream::open() {
     throw std::runtime_error(sl::fmt("FileStream: file % setvbuf failed", 
                                      m_fileName));
   }
+
+#if defined (__linux__)
+  struct stat st;
+  if (m_writeBackChunk != 0 && fstat(fileno(m_stream), &st) == 0) {
+    m_offset = st.st_size;
+    m_writeBackStart = m_writeBackEnd = m_offset;
+  }
+#endif
 }
 
 void FileStream::close() {
   if (m_stream) {
     fflush(m_stream);
+    dropWritten();
     fclose(m_stream);
     m_stream = nullptr;
   }
 }
 
-void FileStream::write(const void* data, size_t size) {
-  auto bytesWritten = fwrite(data, size, 1, m_stream) * size;
-  if (bytesWritten != size) {
-    throw std::runtime_error(sl::fmt("FileStream: file % write failed, bytesWritten = %", 
-                                     m_fileName, bytesWritten));
+int FileStream::write(const void* data, size_t size) {
+  if (m_stream == nullptr)
+    return EBADF;
+
+  errno = 0;
+  if (size != 0 && fwrite(data, size, 1, m_stream) != 1) {
+    int error = errno != 0 ? errno : EIO;
+    clearerr(m_stream);
+    return error;
   }
+
+  m_offset += size;
+  if (m_writeBackChunk != 0 && m_offset - m_writeBackEnd >= m_writeBackChunk)
+    writeBack();
+
+  return 0;
+}
+
+void FileStream::sync() {
+  if (m_stream == nullptr)
+    return;
+
+#if defined (__linux__)
+  int result = fdatasync(fileno(m_stream));
+#elif defined (_WIN32)
+  int result = _commit(_fileno(m_stream));
+#else
+  int result = fsync(fileno(m_stream));
+#endif
+  if (result != 0) {
+    throw std::runtime_error(sl::fmt("FileStream: file % sync failed", 
+                                     m_fileName));
+  }
+}
+
+/* Starts writing out the data written since the last call and waits for the
+   write out of the previous range started a chunk ago (normally finished by
+   now), so dirty pages never pile up. Nothing new is submitted or waited for
+   on the previous range, the writers hold the manager lock here. It is then
+   dropped from the page cache, pages still dirty are kept. */
+void FileStream::writeBack() {
+#if defined (__linux__)
+  int fd = fileno(m_stream);
+  sync_file_range(fd, m_writeBackEnd, m_offset - m_writeBackEnd, 
+                  SYNC_FILE_RANGE_WRITE);
+  if (m_writeBackStart < m_writeBackEnd) {
+    sync_file_range(fd, m_writeBackStart, m_writeBackEnd - m_writeBackStart,
+                    SYNC_FILE_RANGE_WAIT_BEFORE);
+    posix_fadvise(fd, m_writeBackStart, m_writeBackEnd - m_writeBackStart, 
+                  POSIX_FADV_DONTNEED);
+  }
+#endif
+  m_writeBackStart = m_writeBackEnd;
+  m_writeBackEnd = m_offset;
+}
+
+/* On close the tail is sent to the disk without waiting and everything
+   already written out is dropped from the cache */
+void FileStream::dropWritten() {
+#if defined (__linux__)
+  if (m_writeBackChunk == 0)
+    return;
+
+  int fd = fileno(m_stream);
+  if (m_writeBackEnd < m_offset)
+    sync_file_range(fd, m_writeBackEnd, m_offset - m_writeBackEnd, SYNC_FILE_RANGE_WRITE);
+  posix_fadvise(fd, 0, m_writeBackEnd, POSIX_FADV_DONTNEED);
+#endif
 }
 
 bool FileStream::isOpened() const {
   return m_stream != nullptr;
 }
 
+int FileStream::fd() const {
+#if defined (_WIN32)
+  return m_stream != nullptr ? _fileno(m_stream) : -1;
+#else
+  return m_stream != nullptr ? fileno(m_stream) : -1;
+#endif
+}
+
 }
 }
\ No newline at end of file
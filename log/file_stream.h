@@ -3,6 +3,7 @@
 #include <memory>
 #include <stdio.h>
 #include <string>
+#include <cstdint>
 
 namespace sl {
 namespace detail {
@@ -12,22 +13,41 @@ public:
   virtual ~IFileStream() {}
   virtual void open() = 0;
   virtual void close() = 0;
-  virtual void write(const void* data, size_t size) = 0;
+  /* Returns 0 or an errno value, doesn't throw */
+  virtual int write(const void* data, size_t size) = 0;
+  /* Flushes written data to the disk. May be called concurrently with
+     write(), but not with open() and close(). */
+  virtual void sync() = 0;
   virtual bool isOpened() const = 0;
+  /* Descriptor of the opened file, -1 if there is none */
+  virtual int fd() const = 0;
 };
 
 class FileStream : public IFileStream {
 public:
-  FileStream(const std::string& fileName);
+  /* With non zero writeBackChunk every chunk of written data is sent to the
+     disk right away, the write out of the one before it is waited for and
+     it is dropped from the page cache (Linux only). */
+  FileStream(const std::string& fileName, int64_t writeBackChunk = 0);
   ~FileStream();
   virtual void open() override;
   virtual void close() override;
-  virtual void write(const void* data, size_t size) override;
+  virtual int write(const void* data, size_t size) override;
+  virtual void sync() override;
   virtual bool isOpened() const override;
+  virtual int fd() const override;
+
+private:
+  void writeBack();
+  void dropWritten();
 
 private:
   std::string m_fileName;
   FILE* m_stream;
+  int64_t m_writeBackChunk;
+  int64_t m_offset;
+  int64_t m_writeBackStart;
+  int64_t m_writeBackEnd;
 };
 
 using FileStreamPtr = std::unique_ptr<IFileStream>;
@@ -0,0 +1,204 @@
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <stdexcept>
+#include <log/flight_recorder.h>
+#include <log/format.h>
+
+#if defined (_WIN32)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+const char kMagic[4] = {'S', 'L', 'F', 'R'};
+const uint32_t kVersion = 1;
+const size_t kVersionOffset = 4;
+const size_t kCapacityOffset = 8;
+const size_t kPositionOffset = 16;
+
+uint64_t getField(const char* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+}
+
+FlightRecorder::FlightRecorder(const std::string& fileName, int64_t capacity) :
+  m_fileName(fileName),
+  m_capacity((uint64_t)capacity),
+  m_base(nullptr),
+  m_data(nullptr),
+  m_position(nullptr)
+#if defined (_WIN32)
+  , m_file(INVALID_HANDLE_VALUE),
+  m_mapping(nullptr)
+#else
+  , m_fd(-1)
+#endif
+{
+  if (capacity <= 0)
+    throw std::runtime_error(sl::fmt("FlightRecorder: % capacity should be positive", fileName));
+
+  map();
+  m_data = m_base + kFlightHeaderSize;
+  m_position = reinterpret_cast<std::atomic<uint64_t>*>(m_base + kPositionOffset);
+
+  uint32_t version;
+  memcpy(&version, m_base + kVersionOffset, sizeof(version));
+  if (memcmp(m_base, kMagic, sizeof(kMagic)) != 0 || version != kVersion ||
+      getField(m_base + kCapacityOffset) != m_capacity) {
+    memset(m_base, 0, kFlightHeaderSize);
+    memcpy(m_base, kMagic, sizeof(kMagic));
+    memcpy(m_base + kVersionOffset, &kVersion, sizeof(kVersion));
+    memcpy(m_base + kCapacityOffset, &m_capacity, sizeof(m_capacity));
+    m_position->store(0);
+  }
+}
+
+FlightRecorder::~FlightRecorder() {
+  unmap();
+}
+
+void FlightRecorder::write(const void* data, size_t size) {
+  auto bytes = static_cast<const char*>(data);
+  if (size > m_capacity) {
+    bytes += size - m_capacity;
+    size = (size_t)m_capacity;
+  }
+
+  uint64_t offset = m_position->fetch_add(size, std::memory_order_relaxed) % m_capacity;
+  size_t first = (size_t)std::min<uint64_t>(size, m_capacity - offset);
+  memcpy(m_data + offset, bytes, first);
+  memcpy(m_data, bytes + first, size - first);
+}
+
+#if defined (_WIN32)
+
+void FlightRecorder::map() {
+  uint64_t size = kFlightHeaderSize + m_capacity;
+  m_file = CreateFileA(m_fileName.c_str(), GENERIC_READ | GENERIC_WRITE,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error(sl::fmt("FlightRecorder: open % failed", m_fileName));
+
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, 
+                                 (DWORD)(size >> 32), (DWORD)size, nullptr);
+  if (m_mapping != nullptr)
+    m_base = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size));
+
+  if (m_base == nullptr) {
+    unmap();
+    throw std::runtime_error(sl::fmt("FlightRecorder: map % failed", m_fileName));
+  }
+}
+
+void FlightRecorder::unmap() {
+  if (m_base != nullptr)
+    UnmapViewOfFile(m_base);
+  if (m_mapping != nullptr)
+    CloseHandle(m_mapping);
+  if (m_file != INVALID_HANDLE_VALUE)
+    CloseHandle(m_file);
+  m_base = nullptr;
+  m_mapping = nullptr;
+  m_file = INVALID_HANDLE_VALUE;
+}
+
+void FlightRecorder::sync() {
+  FlushViewOfFile(m_base, 0);
+}
+
+#else
+
+void FlightRecorder::map() {
+  auto size = (off_t)(kFlightHeaderSize + m_capacity);
+  m_fd = ::open(m_fileName.c_str(), O_RDWR | O_CREAT, 0644);
+  if (m_fd < 0)
+    throw std::runtime_error(sl::fmt("FlightRecorder: open % failed", m_fileName));
+
+  struct stat st;
+  bool sized = fstat(m_fd, &st) == 0 && 
+               (st.st_size == size || ftruncate(m_fd, size) == 0);
+#if defined (__linux__)
+  /* Allocated up front, a page fault on a full disk would be a SIGBUS */
+  sized = sized && posix_fallocate(m_fd, 0, size) == 0;
+#endif
+  void* base = sized ? mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)
+                     : MAP_FAILED;
+  if (base == MAP_FAILED) {
+    unmap();
+    throw std::runtime_error(sl::fmt("FlightRecorder: map % failed", m_fileName));
+  }
+
+  m_base = static_cast<char*>(base);
+}
+
+void FlightRecorder::unmap() {
+  if (m_base != nullptr)
+    munmap(m_base, kFlightHeaderSize + m_capacity);
+  if (m_fd >= 0)
+    ::close(m_fd);
+  m_base = nullptr;
+  m_fd = -1;
+}
+
+void FlightRecorder::sync() {
+  msync(m_base, kFlightHeaderSize + m_capacity, MS_ASYNC);
+}
+
+#endif
+
+std::string FlightRecorder::recover(const std::string& fileName) {
+  using FilePtr = std::unique_ptr<FILE, int(*)(FILE*)>;
+  FilePtr file(fopen(fileName.c_str(), "rb"), fclose);
+  if (!file)
+    throw std::runtime_error(sl::fmt("FlightRecorder: open % failed", fileName));
+
+  char header[kFlightHeaderSize];
+  if (fread(header, sizeof(header), 1, file.get()) != 1 ||
+      memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error(sl::fmt("FlightRecorder: % is not a recorder file", fileName));
+  }
+
+  uint64_t capacity = getField(header + kCapacityOffset);
+  uint64_t position = getField(header + kPositionOffset);
+  std::string data((size_t)capacity, '\0');
+  if (capacity == 0 || fread(&data[0], data.size(), 1, file.get()) != 1)
+    throw std::runtime_error(sl::fmt("FlightRecorder: % is truncated", fileName));
+
+  std::string result;
+  if (position <= capacity) {
+    result = data.substr(0, (size_t)position);
+  } else {
+    /* Unless the ring starts within the "\n\n" ending a record it is
+       taken for the rest of an overwritten one */
+    auto start = (size_t)(position % capacity);
+    result = data.substr(start) + data.substr(0, start);
+    size_t skip;
+    if (result[0] == '\n') {
+      skip = result.find_first_not_of('\n');
+    } else {
+      skip = result.find("\n\n");
+      if (skip != std::string::npos)
+        skip += 2;
+    }
+    result.erase(0, skip == std::string::npos ? result.size() : skip);
+  }
+
+  result.erase(std::remove(result.begin(), result.end(), '\0'), result.end());
+  return result;
+}
+
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <memory>
+
+namespace sl {
+namespace detail {
+
+/* Records ring in a memory mapped file. Writers reserve space by advancing
+   the position kept in the file header and copy the record in, so the
+   pages (and thus the last records) are written back by the kernel even if
+   the process crashes.
+
+   header: "SLFR", u32 version, u64 capacity, u64 position, zero padding to
+           kFlightHeaderSize
+   data:   capacity bytes, record bytes at position % capacity
+
+   Numbers are in the native byte order, position is the total number of
+   bytes ever written. It is advanced before the copy, so a write cut by a
+   crash leaves the previous bytes (zeros on the first lap) in place. */
+
+const size_t kFlightHeaderSize = 64;
+
+class FlightRecorder {
+public:
+  /* Maps fileName with capacity bytes for the records. A file left by a
+     recorder of the same capacity is continued, other files are
+     overwritten. Throws on errors. */
+  FlightRecorder(const std::string& fileName, int64_t capacity);
+  ~FlightRecorder();
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  /* Lock free, records longer than the capacity keep only their tail */
+  void write(const void* data, size_t size);
+  /* Asks the kernel to write the pages back now */
+  void sync();
+
+  const std::string& fileName() const { return m_fileName; }
+  uint64_t position() const { return m_position->load(std::memory_order_relaxed); }
+
+  /* Reads the records from a recorder file (the process may be running),
+     oldest first. Once the ring has wrapped, the oldest record (which may
+     be partially overwritten) is cut off, as are zeros of the never
+     written space. Throws if fileName
+     is not a recorder file. */
+  static std::string recover(const std::string& fileName);
+
+private:
+  void map();
+  void unmap();
+
+private:
+  std::string m_fileName;
+  uint64_t m_capacity;
+  char* m_base;
+  char* m_data;
+  std::atomic<uint64_t>* m_position;
+#if defined (_WIN32)
+  void* m_file;
+  void* m_mapping;
+#else
+  int m_fd;
+#endif
+};
+
+using FlightRecorderPtr = std::unique_ptr<FlightRecorder>;
+
+}
+}
@@ -0,0 +1,50 @@
+#include <log/flush_barrier.h>
+
+namespace sl {
+namespace detail {
+
+FlushBarrier::FlushBarrier() 
+  : m_requested(0),
+    m_completed(0),
+    m_running(false) 
+{
+}
+
+uint64_t FlushBarrier::requested() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_requested;
+}
+
+void FlushBarrier::run(const Action& action) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto ticket = ++m_requested;
+
+  while (m_completed < ticket) {
+    if (m_running) {
+      m_cond.wait(lock);
+      continue;
+    }
+
+    /* Everyone who has come so far is covered by this run */
+    auto batch = m_requested;
+    m_running = true;
+    lock.unlock();
+
+    try {
+      action();
+    } catch (...) {
+      lock.lock();
+      m_running = false;
+      m_cond.notify_all();
+      throw;
+    }
+
+    lock.lock();
+    m_running = false;
+    m_completed = batch;
+    m_cond.notify_all();
+  }
+}
+
+}
+}
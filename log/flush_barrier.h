@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+namespace sl {
+namespace detail {
+
+/* Group commit: concurrent callers of run() are served by a single call of
+   the action which has started after all of them have arrived. */
+class FlushBarrier {
+public:
+  using Action = std::function<void()>;
+
+  FlushBarrier();
+  /* Returns after an action started after this call has finished. Exceptions
+     thrown by the action are rethrown to the thread which has run it only. */
+  void run(const Action& action);
+  /* Calls of run() so far */
+  uint64_t requested() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  uint64_t m_requested;
+  uint64_t m_completed;
+  bool m_running;
+};
+
+}
+}
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <algorithm>
+#include <log/latency_histogram.h>
+
+namespace sl {
+
+int64_t LatencyHistogram::percentile(double q) const {
+  if (count == 0)
+    return 0;
+
+  auto target = std::max<uint64_t>(1, (uint64_t)std::ceil(q * count));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= target)
+      return std::min(detail::AtomicHistogram::upperBound(i), max);
+  }
+  return max;
+}
+
+namespace detail {
+
+const size_t AtomicHistogram::kSubBucketBits;
+const size_t AtomicHistogram::kBuckets;
+
+namespace {
+
+const uint64_t kSubBuckets = 1 << AtomicHistogram::kSubBucketBits;
+
+/* Index of the highest set bit */
+size_t highestBit(uint64_t value) {
+  size_t result = 0;
+  for (size_t shift = 32; shift != 0; shift /= 2) {
+    if (value >> shift) {
+      value >>= shift;
+      result += shift;
+    }
+  }
+  return result;
+}
+
+}
+
+AtomicHistogram::AtomicHistogram() : m_max(0) {
+  for (auto& bucket: m_buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void AtomicHistogram::add(int64_t value) {
+  if (value < 0)
+    value = 0;
+  m_buckets[bucket((uint64_t)value)].fetch_add(1, std::memory_order_relaxed);
+
+  auto max = m_max.load(std::memory_order_relaxed);
+  while (value > max && 
+         !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram AtomicHistogram::snapshot(bool reset) {
+  LatencyHistogram result;
+  result.buckets.resize(kBuckets);
+  result.max = reset ? m_max.exchange(0, std::memory_order_relaxed) :
+                       m_max.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < kBuckets; ++i) {
+    result.buckets[i] = reset ? m_buckets[i].exchange(0, std::memory_order_relaxed) :
+                                m_buckets[i].load(std::memory_order_relaxed);
+    result.count += result.buckets[i];
+  }
+  return result;
+}
+
+size_t AtomicHistogram::bucket(uint64_t value) {
+  if (value < kSubBuckets)
+    return (size_t)value;
+
+  auto bit = highestBit(value);
+  auto shift = bit - kSubBucketBits;
+  auto sub = (value >> shift) & (kSubBuckets - 1);
+  return ((bit - kSubBucketBits + 1) << kSubBucketBits) + (size_t)sub;
+}
+
+int64_t AtomicHistogram::upperBound(size_t bucket) {
+  if (bucket < kSubBuckets)
+    return (int64_t)bucket;
+
+  auto shift = (bucket >> kSubBucketBits) - 1;
+  auto sub = bucket & (kSubBuckets - 1);
+  auto lower = (kSubBuckets + sub) << shift;
+  return (int64_t)std::min<uint64_t>(lower + ((uint64_t)1 << shift) - 1, INT64_MAX);
+}
+
+LatencyStats SinkLatency::snapshot(bool reset) {
+  LatencyStats result;
+  result.format = format.snapshot(reset);
+  result.lock = lock.snapshot(reset);
+  result.queue = queue.snapshot(reset);
+  result.write = write.snapshot(reset);
+  result.total = total.snapshot(reset);
+  return result;
+}
+
+}
+}
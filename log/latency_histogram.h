@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace sl {
+
+/* Snapshot of a log-linear histogram of nanosecond latencies: values
+   below 8 have a bucket each, every power of two above is split into 8
+   buckets, so a bucket is within 12.5% of the values it holds */
+struct LatencyHistogram {
+  uint64_t count;
+  int64_t max;
+  std::vector<uint64_t> buckets;
+
+  LatencyHistogram() : count(0), max(0) {}
+
+  /* Upper bound of the bucket holding the q-th quantile (0 - 1), capped by
+     max. 0 if empty. */
+  int64_t percentile(double q) const;
+};
+
+/* Time spent by records in each stage of the way to the disk */
+struct LatencyStats {
+  LatencyHistogram format; /* the header and the message */
+  LatencyHistogram lock;   /* waiting for the sink mutex, synchronous sinks */
+  LatencyHistogram queue;  /* from the push to the writer thread taking the
+                              record, asynchronous sinks */
+  LatencyHistogram write;  /* in LogFilesManager::write */
+  LatencyHistogram total;  /* from the start of formatting to the end of
+                              the write */
+};
+
+namespace detail {
+
+/* Lock-free recording side of LatencyHistogram */
+class AtomicHistogram {
+public:
+  static const size_t kSubBucketBits = 3;
+  static const size_t kBuckets = (64 - kSubBucketBits + 1) << kSubBucketBits;
+
+  AtomicHistogram();
+  AtomicHistogram(const AtomicHistogram&) = delete;
+  AtomicHistogram& operator=(const AtomicHistogram&) = delete;
+
+  void add(int64_t value);
+  /* With reset the buckets are zeroed one by one, a concurrent value is
+     counted either in this snapshot or in the next one */
+  LatencyHistogram snapshot(bool reset);
+
+  static size_t bucket(uint64_t value);
+  static int64_t upperBound(size_t bucket);
+
+private:
+  std::atomic<uint64_t> m_buckets[kBuckets];
+  std::atomic<int64_t> m_max;
+};
+
+struct SinkLatency {
+  AtomicHistogram format;
+  AtomicHistogram lock;
+  AtomicHistogram queue;
+  AtomicHistogram write;
+  AtomicHistogram total;
+
+  LatencyStats snapshot(bool reset);
+};
+
+using SinkLatencyPtr = std::unique_ptr<SinkLatency>;
+
+}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace sl {
+
+enum class Level {
+  debug,
+  info,
+  warning,
+  error,
+  critical
+};
+
+}
@@ -3,45 +3,54 @@
 #include <thread>
 #include <iomanip>
 
-#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
-#include <sys/time.h>
-#elif defined (_WIN32)
-
-// this function is taken somewhere from stackoverflow
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#include <stdint.h> 
-
-typedef struct timeval {
-	long tv_sec;
-	long tv_usec;
-} timeval;
-
-int gettimeofday(struct timeval * tp, struct timezone * tzp)
-{
-	static const uint64_t EPOCH = ((uint64_t)116444736000000000ULL);
+#include "log.h"
+#include <log/utils.h>
 
-	SYSTEMTIME  system_time;
-	FILETIME    file_time;
-	uint64_t    time;
+namespace sl {
 
-	GetSystemTime(&system_time);
-	SystemTimeToFileTime(&system_time, &file_time);
-	time = ((uint64_t)file_time.dwLowDateTime);
-	time += ((uint64_t)file_time.dwHighDateTime) << 32;
+using namespace detail;
 
-	tp->tv_sec = (long)((time - EPOCH) / 10000000L);
-	tp->tv_usec = (long)(system_time.wMilliseconds * 1000);
-	return 0;
+namespace {
+
+/* Written directly to the files, like the drop notices */
+void writeRepeats(LogFilesManager* fileManager, 
+                  bool duplicateToStdout,
+                  const std::string& timeFormat, 
+                  Level level, 
+                  uint64_t repeats) {
+  std::stringstream messageStream;
+  auto timestamp = ts::now();
+  writeLogData(messageStream, level, timeFormat, timestamp);
+  messageStream << std::dec << "last message repeated " << repeats << " times" 
+                << std::endl << std::endl;
+  auto outString = messageStream.str();
+  fileManager->write(outString.data(), outString.size(), timestamp);
+  if (duplicateToStdout) {
+    std::cout << outString;
+  }
 }
 
-#endif
-
-#include "log.h"
-
-namespace sl {
+/* Should be called by the sink writer. Returns false if the record is a
+   repeat, otherwise reports the repeats of the previous one. */
+bool passRepeats(RepeatFilter* filter,
+                 LogFilesManager* fileManager, 
+                 bool duplicateToStdout,
+                 const std::string& timeFormat, 
+                 Level level, 
+                 uint64_t hash) {
+  if (!filter || hash == 0)
+    return true;
+
+  uint64_t repeats = 0;
+  Level repeatsLevel = level;
+  if (!filter->pass(hash, level, repeats, repeatsLevel))
+    return false;
+  if (repeats != 0)
+    writeRepeats(fileManager, duplicateToStdout, timeFormat, repeatsLevel, repeats);
+  return true;
+}
 
-using namespace detail;
+}
 
 Logger::Logger() 
     : m_timeFormat("%Y-%m-%d %H:%M:%S") {
@@ -53,8 +62,9 @@ Logger::SinkMapConstIterator Logger::getSinkById(int sinkId) const {
 
 Logger::SinkMapIterator Logger::getSinkById(int sinkId) {
   auto sinkIt = m_sinks.find(sinkId);
-  detail::throwLoggerExceptionIfNot(sinkIt != m_sinks.cend(),
-                      fmt("sinkId % not found", sinkId));
+  /* the message is only formatted on failure, lookups are on the logging path */
+  if (sinkIt == m_sinks.cend())
+    throw detail::LoggerException(fmt("sinkId % not found", sinkId));
   return sinkIt;
 }
 
@@ -68,6 +78,13 @@ void Logger::setDefaultSink(const std::string& logDir,
     totalLimit, fileLimit, duplicateToStdout);
 }
 
+void Logger::setDefaultSink(const std::string& logDir,
+                            const std::string& fileNamePattern,
+                            Level level,
+                            const SinkOptions& options) {
+  addSink(kDefaultSinkId, logDir, fileNamePattern, level, options);
+}
+
 void Logger::addSink(int sinkId, 
                      const std::string& logDir, 
                      const std::string& fileNamePattern, 
@@ -75,6 +92,15 @@ void Logger::addSink(int sinkId,
                      int64_t totalLimit, 
                      int64_t fileLimit,
                      bool duplicateToStdout) {
+  addSink(sinkId, logDir, fileNamePattern, level,
+          SinkOptions(totalLimit, fileLimit, duplicateToStdout));
+}
+
+void Logger::addSink(int sinkId,
+                     const std::string& logDir,
+                     const std::string& fileNamePattern,
+                     Level level,
+                     const SinkOptions& options) {
   std::lock_guard<sm::shared_mutex> lock(m_sinksMutex);
   if (m_sinks.find(sinkId) != m_sinks.cend()) {
     throw std::runtime_error(
@@ -83,25 +109,227 @@ void Logger::addSink(int sinkId,
             sinkId));
   }
   checkSinkWithPattern(fileNamePattern);
-  bool emplaceResult = 
-      m_sinks.emplace(
-          sinkId, 
-          Sink(level, 
-               detail::LogFilesManagerPtr( 
-                  new detail::LogFilesManager(
-                      totalLimit, 
-                      fileLimit,
-                      FileEntryCatalogPtr(new FileEntryCatalog(
-                          new FileEntryFactory(),
-                          logDir,
-                          fileNamePattern)))), 
-               duplicateToStdout)).second;
+  Sink sink(level, 
+            detail::LogFilesManagerPtr( 
+               new detail::LogFilesManager(
+                   FileEntryCatalogPtr(new FileEntryCatalog(
+                       new FileEntryFactory(options.writeBackChunk),
+                       logDir,
+                       fileNamePattern)),
+                   options)), 
+            options.duplicateToStdout,
+            options.durability);
+  if (options.latencyHistograms)
+    sink.latency.reset(new detail::SinkLatency);
+  if (options.suppressRepeats) {
+    auto fileManager = sink.fileManager.get();
+    auto duplicateToStdout = sink.duplicateToStdout;
+    auto timeFormat = m_timeFormat;
+    sink.repeats.reset(new detail::RepeatFilter(
+        [fileManager, duplicateToStdout, timeFormat](Level level, uint64_t repeats) {
+          writeRepeats(fileManager, duplicateToStdout, timeFormat, level, repeats);
+        }));
+  }
+  if (options.async.queueSize != 0)
+    sink.writer = createWriter(sink, options);
+  if (options.backtrace.size != 0)
+    sink.backtrace.reset(new detail::Backtrace(options.backtrace));
+  if (options.flightRecorder.size != 0) {
+    /* hidden, so the catalog (<base>*) never rotates or deletes it */
+    auto recorderName = options.flightRecorder.fileName.empty() ?
+        fs::join(logDir, str::join(".", fileNamePattern, ".flight")) :
+        options.flightRecorder.fileName;
+    sink.recorder.reset(new detail::FlightRecorder(recorderName, options.flightRecorder.size));
+    sink.recorderLevel = options.flightRecorder.level;
+  }
+  sink.crashTarget.reset(new detail::CrashTarget(sink.fileManager.get(),
+                                                 sink.writer.get(),
+                                                 sink.recorder.get()));
+
+  auto emplaceResult = m_sinks.emplace(sinkId, std::move(sink));
   detail::throwLoggerExceptionIfNot(
-      emplaceResult, 
+      emplaceResult.second, 
       fmt("% Emplace failed. fileName pattern = %. sinkId = %",
           __FUNCTION__,
           fileNamePattern, 
           sinkId));
+
+  /* The map nodes don't move, so the emitter can keep the sink address */
+  if (options.statsInterval > 0) {
+    auto& stored = emplaceResult.first->second;
+    stored.statsEmitter.reset(new detail::Worker(options.housekeeperThread));
+    scheduleStats(stored, options.statsInterval, m_timeFormat);
+  }
+}
+
+/* Should be called with m_sinksMutex locked. The writer thread never takes
+   the logger lock, so the drop notices use the time format set by now. */
+detail::AsyncWriterPtr Logger::createWriter(const Sink& sink, 
+                                            const SinkOptions& options) const {
+  auto fileManager = sink.fileManager.get();
+  auto duplicateToStdout = sink.duplicateToStdout;
+  auto timeFormat = m_timeFormat;
+  auto latency = sink.latency.get();
+  auto repeats = sink.repeats.get();
+
+  auto write = [fileManager, duplicateToStdout, latency, repeats, timeFormat](
+      const detail::Record& record) {
+    if (!passRepeats(repeats, fileManager, duplicateToStdout, timeFormat, 
+                     record.level, record.hash))
+      return;
+    if (latency && record.loggedAt != 0) {
+      auto start = detail::ts::steadyNs();
+      fileManager->write(record.data.data(), record.data.size(), record.timestamp);
+      auto end = detail::ts::steadyNs();
+      latency->queue.add(record.takenAt - record.queuedAt);
+      latency->write.add(end - start);
+      latency->total.add(end - record.loggedAt);
+    } else {
+      fileManager->write(record.data.data(), record.data.size(), record.timestamp);
+    }
+    if (duplicateToStdout) {
+      std::cout << record.data;
+    }
+  };
+
+  auto notice = [fileManager, duplicateToStdout, timeFormat](uint64_t dropped) {
+    std::stringstream messageStream;
+    auto timestamp = detail::ts::now();
+    detail::writeLogData(messageStream, Level::warning, timeFormat, timestamp);
+    messageStream << std::dec << dropped << " records dropped" << std::endl << std::endl;
+    auto outString = messageStream.str();
+    fileManager->write(outString.data(), outString.size(), timestamp);
+    if (duplicateToStdout) {
+      std::cout << outString;
+    }
+  };
+
+  return detail::AsyncWriterPtr(
+      new detail::AsyncWriter(options.async, write, notice, options.writerThread));
+}
+
+SinkStats Logger::sinkStats(const Sink& sink) {
+  auto result = sink.fileManager->stats();
+  result.filtered = sink.filtered->value();
+  if (sink.writer) {
+    auto queueStats = sink.writer->stats();
+    result.dropped += queueStats.dropped;
+    result.maxQueueDepth = queueStats.maxDepth;
+  }
+  return result;
+}
+
+/* Like the drop notices, the stats records are written without the logger
+   lock and with the time format set by the time the sink was added */
+void Logger::scheduleStats(Sink& sink, int64_t interval, const std::string& timeFormat) {
+  sink.statsEmitter->post([this, &sink, interval, timeFormat] {
+                            scheduleStats(sink, interval, timeFormat);
+                            writeStats(sink, timeFormat);
+                          },
+                          std::chrono::milliseconds(interval));
+}
+
+void Logger::writeStats(Sink& sink, const std::string& timeFormat) {
+  auto stats = sinkStats(sink);
+  std::stringstream messageStream;
+  auto timestamp = detail::ts::now();
+  detail::writeLogData(messageStream, Level::info, timeFormat, timestamp,
+                       sink.writer ? sink.writer->nextSequence() : 0);
+  messageStream << std::dec << "sl: stats"
+                << " written=" << stats.written
+                << " filtered=" << stats.filtered
+                << " dropped=" << stats.dropped
+                << " bytes=" << stats.bytes
+                << " rotations=" << stats.rotations
+                << " deletions=" << stats.deletions
+                << " writeErrors=" << stats.writeErrors
+                << " writeTimeNs=" << stats.writeTime
+                << " rotationTimeNs=" << stats.rotationTime
+                << " maxQueueDepth=" << stats.maxQueueDepth
+                << std::endl << std::endl;
+  pushRecord(sink, Level::info, timestamp, messageStream.str());
+}
+
+/* The recorder copy is made before queueing, so the asynchronous sinks
+   don't lose it on a crash either */
+void Logger::writeRecord(Sink& sink, Level level, int64_t timestamp, std::string data,
+                         int64_t loggedAt, uint64_t hash) {
+  if (sink.recorder && (int)level >= (int)sink.recorderLevel)
+    sink.recorder->write(data.data(), data.size());
+  pushRecord(sink, level, timestamp, std::move(data), loggedAt, hash);
+}
+
+void Logger::record(Sink& sink, Level level, int64_t timestamp, const std::string& message) {
+  std::stringstream messageStream;
+  detail::writeLogData(messageStream, level, m_timeFormat, timestamp);
+  messageStream << message << std::endl << std::endl;
+  auto outString = messageStream.str();
+  sink.recorder->write(outString.data(), outString.size());
+}
+
+void Logger::pushRecord(Sink& sink, Level level, int64_t timestamp, std::string data,
+                        int64_t loggedAt, uint64_t hash) {
+  bool measured = sink.latency && loggedAt != 0;
+  if (sink.writer) {
+    detail::Record record(std::move(data), timestamp, level);
+    record.hash = hash;
+    if (measured) {
+      record.loggedAt = loggedAt;
+      record.queuedAt = detail::ts::steadyNs();
+    }
+    sink.writer->push(std::move(record));
+  } else if (measured) {
+    writeMeasured(sink, level, timestamp, data, loggedAt, hash);
+  } else {
+    std::lock_guard<std::mutex> lock(*sink.mutex);
+    if (!passRepeats(sink.repeats.get(), sink.fileManager.get(), sink.duplicateToStdout,
+                     m_timeFormat, level, hash))
+      return;
+    sink.fileManager->write(data.data(), data.size(), timestamp);
+    if (sink.duplicateToStdout) {
+      std::cout << data;
+    }
+  }
+
+  /* Outside of the sink lock so that concurrent errors share the sync */
+  if (sink.durability.mode == Durability::onError && 
+      (int)level >= (int)sink.durability.level) {
+    if (sink.writer)
+      sink.writer->flush();
+    sink.fileManager->flush(true);
+  }
+}
+
+/* Synchronous write recording the lock, write and total latency */
+void Logger::writeMeasured(Sink& sink, Level level, int64_t timestamp, 
+                           const std::string& data, int64_t loggedAt, uint64_t hash) {
+  auto lockStart = detail::ts::steadyNs();
+  std::lock_guard<std::mutex> lock(*sink.mutex);
+  if (!passRepeats(sink.repeats.get(), sink.fileManager.get(), sink.duplicateToStdout,
+                   m_timeFormat, level, hash))
+    return;
+  auto start = detail::ts::steadyNs();
+  sink.fileManager->write(data.data(), data.size(), timestamp);
+  auto end = detail::ts::steadyNs();
+  sink.latency->lock.add(start - lockStart);
+  sink.latency->write.add(end - start);
+  sink.latency->total.add(end - loggedAt);
+  if (sink.duplicateToStdout) {
+    std::cout << data;
+  }
+}
+
+/* Entries keep the time and the thread of the capture. The flight
+   recorder has got them on capture if their level is recorded. */
+void Logger::writeBacktrace(Sink& sink) {
+  for (const auto& entry: sink.backtrace->take()) {
+    std::stringstream messageStream;
+    detail::writeLogData(messageStream, entry.level, m_timeFormat, entry.timestamp,
+                         sink.writer ? sink.writer->nextSequence() : 0,
+                         entry.threadId);
+    messageStream << entry.message << std::endl << std::endl;
+    pushRecord(sink, entry.level, entry.timestamp, messageStream.str());
+  }
 }
 
 void Logger::checkSinkWithPattern(const std::string& fileNamePattern) const {
@@ -134,6 +362,24 @@ Level Logger::getDefaultLevel() const {
   return getLevel(kDefaultSinkId);
 }
 
+bool Logger::isEnabled(int sinkId, Level level) const {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  const auto& sink = getSinkById(sinkId)->second;
+  if ((int)level >= (int)sink.level)
+    return true;
+
+  if ((sink.backtrace && sink.backtrace->captures(level)) ||
+      (sink.recorder && (int)level >= (int)sink.recorderLevel))
+    return true;
+
+  sink.filtered->add();
+  return false;
+}
+
+bool Logger::isDefaultEnabled(Level level) const {
+  return isEnabled(kDefaultSinkId, level);
+}
+
 std::string Logger::getFileNamePattern(int sinkId) const {
   sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
   auto sinkIt = getSinkById(sinkId);
@@ -153,6 +399,79 @@ bool Logger::hasDefaultSink() const {
   return hasSink(kDefaultSinkId);
 }
 
+void Logger::flush(int sinkId, bool sync) {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  auto& sink = getSinkById(sinkId)->second;
+  if (sink.writer)
+    sink.writer->flush();
+  if (sink.repeats)
+    flushRepeats(sink);
+  sink.fileManager->flush(sync);
+}
+
+/* The repeats are reported by whoever writes the sink files, the writer
+   thread of the asynchronous sinks, to keep the order with the records */
+void Logger::flushRepeats(Sink& sink) {
+  auto repeats = sink.repeats.get();
+  if (sink.writer) {
+    sink.writer->call([repeats] { repeats->flush(); });
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(*sink.mutex);
+  repeats->flush();
+}
+
+void Logger::flushDefault(bool sync) {
+  flush(kDefaultSinkId, sync);
+}
+
+SinkErrorStats Logger::errorStats(int sinkId) const {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  auto sinkIt = getSinkById(sinkId);
+  return sinkIt->second.fileManager->errorStats();
+}
+
+SinkErrorStats Logger::defaultErrorStats() const {
+  return errorStats(kDefaultSinkId);
+}
+
+QueueStats Logger::queueStats(int sinkId) const {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  auto sinkIt = getSinkById(sinkId);
+  return sinkIt->second.writer ? sinkIt->second.writer->stats() : QueueStats();
+}
+
+SinkStats Logger::stats(int sinkId) const {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  return sinkStats(getSinkById(sinkId)->second);
+}
+
+SinkStats Logger::defaultStats() const {
+  return stats(kDefaultSinkId);
+}
+
+LatencyStats Logger::latencyStats(int sinkId, bool reset) {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  auto& sink = getSinkById(sinkId)->second;
+  return sink.latency ? sink.latency->snapshot(reset) : LatencyStats();
+}
+
+LatencyStats Logger::defaultLatencyStats(bool reset) {
+  return latencyStats(kDefaultSinkId, reset);
+}
+
+void Logger::dumpBacktrace(int sinkId) {
+  sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
+  auto& sink = getSinkById(sinkId)->second;
+  if (sink.backtrace)
+    writeBacktrace(sink);
+}
+
+void Logger::dumpDefaultBacktrace() {
+  dumpBacktrace(kDefaultSinkId);
+}
+
 void Logger::setTimeFormat(const std::string& timeFormatStr) {
   std::lock_guard<sm::shared_mutex> lock(m_sinksMutex);
   m_timeFormat = timeFormatStr;
@@ -170,8 +489,8 @@ Logger& Logger::getLogger() {
 
 namespace detail {
 
-void writeThreadId(std::stringstream& messageStream) {
-  messageStream << std::hex << std::this_thread::get_id() << " ";
+void writeThreadId(std::stringstream& messageStream, std::thread::id threadId) {
+  messageStream << std::hex << threadId << " ";
 }
 
 void writeLevel(std::stringstream& messageStream, Level level) {
@@ -188,26 +507,27 @@ void writeLevel(std::stringstream& messageStream, Level level) {
 }
 
 void writeTime(std::stringstream& messageStream, 
-               const std::string& timeFormat) {
-  struct timeval tv;
-  time_t timeNowSec;
-  struct tm *timeLocal;
+               const std::string& timeFormat,
+               int64_t timestamp) {
+  struct tm timeLocal = ts::localTime(timestamp / 1000000);
   char buf[64];
 
-  gettimeofday(&tv, NULL);
-  timeNowSec = tv.tv_sec;
-  timeLocal = localtime(&timeNowSec);
-  strftime(buf, sizeof(buf), timeFormat.c_str(), timeLocal);
+  strftime(buf, sizeof(buf), timeFormat.c_str(), &timeLocal);
   messageStream << buf << "." << std::setw(3) << std::setfill('0')
-                << (tv.tv_usec / 1000) << " ";
+                << (timestamp % 1000000 / 1000) << " ";
 }
 
 void writeLogData(std::stringstream& messageStream, 
                   Level level,
-                  const std::string& timeFormat) {
-  writeTime(messageStream, timeFormat);
+                  const std::string& timeFormat,
+                  int64_t timestamp,
+                  uint64_t sequence,
+                  std::thread::id threadId) {
+  writeTime(messageStream, timeFormat, timestamp);
   writeLevel(messageStream, level);
-  writeThreadId(messageStream);
+  if (sequence != 0)
+    messageStream << "#" << sequence << " ";
+  writeThreadId(messageStream, threadId);
 }
 
 } // detail
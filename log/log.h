@@ -7,29 +7,39 @@
 #include <fstream>
 #include <iostream>
 #include <cstdint>
+#include <thread>
 
 #include <sm/shared_mutex.h>
 #include <log/format.h>
 #include <log/exception.h>
+#include <log/level.h>
+#include <log/sink_options.h>
 #include <log/log_files_manager.h>
+#include <log/async_writer.h>
+#include <log/backtrace.h>
+#include <log/flight_recorder.h>
+#include <log/crash_handler.h>
+#include <log/sharded_counter.h>
+#include <log/latency_histogram.h>
+#include <log/call_site.h>
+#include <log/rate_limit.h>
+#include <log/repeat_filter.h>
+#include <log/worker.h>
+#include <log/utils.h>
 
 namespace sl {
 
-enum class Level {
-  debug,
-  info,
-  warning,
-  error,
-  critical
-};
-
 namespace detail {
 
 const int kDefaultSinkId = -10001;
 
+/* Non zero sequence is written as "#<sequence>" after the level */
 void writeLogData(std::stringstream& messageStream, 
                   Level level,
-                  const std::string& timeFormat);
+                  const std::string& timeFormat,
+                  int64_t timestamp,
+                  uint64_t sequence = 0,
+                  std::thread::id threadId = std::this_thread::get_id());
 }
 
 class Logger {
@@ -37,18 +47,40 @@ class Logger {
     detail::LogFilesManagerPtr fileManager;
     Level level;
     bool duplicateToStdout;
+    DurabilityOptions durability;
     std::unique_ptr<std::mutex> mutex;
+    /* Set with SinkOptions::latencyHistograms, outlives the writer */
+    detail::SinkLatencyPtr latency;
+    /* Set with SinkOptions::suppressRepeats, outlives the writer and
+       reports the repeats left on destruction */
+    detail::RepeatFilterPtr repeats;
+    /* Set for the asynchronous sinks, destroyed before the fileManager */
+    detail::AsyncWriterPtr writer;
+    detail::BacktracePtr backtrace;
+    detail::FlightRecorderPtr recorder;
+    Level recorderLevel;
+    std::unique_ptr<detail::ShardedCounter> filtered;
+    /* Writes the stats records, stopped before the rest is destroyed */
+    detail::WorkerPtr statsEmitter;
+    /* Declared last to be unregistered first */
+    detail::CrashTargetPtr crashTarget;
 
     Sink() : level(Level::error),
-             duplicateToStdout(false) {}
+             duplicateToStdout(false),
+             recorderLevel(Level::debug),
+             filtered(new detail::ShardedCounter) {}
 
     Sink(Level level, 
          detail::LogFilesManagerPtr fileManager, 
-         bool duplicateToStdout) :
+         bool duplicateToStdout,
+         const DurabilityOptions& durability = DurabilityOptions()) :
       fileManager(std::move(fileManager)),
       level(level),
       duplicateToStdout(duplicateToStdout),
-      mutex(new std::mutex) {}
+      durability(durability),
+      mutex(new std::mutex),
+      recorderLevel(Level::debug),
+      filtered(new detail::ShardedCounter) {}
   };
 
   using SinkMap = std::unordered_map<int, Sink>;
@@ -63,6 +95,11 @@ public:
   Level getLevel(int sinkId) const;
   Level getDefaultLevel() const;
 
+  /* Whether a record of level goes to the sink, its backtrace or flight
+     recorder */
+  bool isEnabled(int sinkId, Level level) const;
+  bool isDefaultEnabled(Level level) const;
+
   void addSink(int sinkId, 
                const std::string& logDir,
                const std::string& fileNamePattern,
@@ -71,6 +108,12 @@ public:
                int64_t fileLimit,
                bool duplicateToStdout = false);
 
+  void addSink(int sinkId,
+               const std::string& logDir,
+               const std::string& fileNamePattern,
+               Level level,
+               const SinkOptions& options);
+
   bool hasSink(int sinkId) const;
 
   void setDefaultSink(const std::string& logDir, 
@@ -80,26 +123,63 @@ public:
                       int64_t fileLimit,
                       bool duplicateToStdout = false);
 
+  void setDefaultSink(const std::string& logDir,
+                      const std::string& fileNamePattern,
+                      Level level,
+                      const SinkOptions& options);
+
   bool hasDefaultSink() const;
 
+  /* Returns when the records logged so far are written to the sink files
+     and, if sync is set, are on the disk. Concurrent flushes are served by
+     one sync. */
+  void flush(int sinkId, bool sync = true);
+  void flushDefault(bool sync = true);
+
+  /* Logging doesn't throw on I/O errors, they are counted here and reported
+     to SinkOptions::errors.handler */
+  SinkErrorStats errorStats(int sinkId) const;
+  SinkErrorStats defaultErrorStats() const;
+  /* Zeroes for the synchronous sinks */
+  QueueStats queueStats(int sinkId) const;
+  SinkStats stats(int sinkId) const;
+  SinkStats defaultStats() const;
+  /* Empty unless SinkOptions::latencyHistograms is set. With reset the
+     histograms start over after the snapshot. */
+  LatencyStats latencyStats(int sinkId, bool reset = false);
+  LatencyStats defaultLatencyStats(bool reset = false);
+
+  /* Writes the records kept in the sink backtrace, if any */
+  void dumpBacktrace(int sinkId);
+  void dumpDefaultBacktrace();
+
+  /* With a backtrace or a flight recorder, records below the sink level
+     only go to them instead of being written. Returns the size of the
+     written record, 0 for such records. */
   template<typename... Args>
-  void log(int sinkId, Level level, 
-           const char* formatString, 
-           Args&&... args) {
+  size_t log(int sinkId, Level level, 
+             const char* formatString, 
+             Args&&... args) {
     sm::shared_lock<sm::shared_mutex> lock(m_sinksMutex);
-    auto sinkIt = getSinkById(sinkId);
-    writeToSink(sinkIt->second, 
-                level, 
-                formatString, 
-                std::forward<Args>(args)...);
+    auto& sink = getSinkById(sinkId)->second;
+    if ((sink.backtrace || sink.recorder) && (int)level < (int)sink.level) {
+      captureBelowLevel(sink, level, formatString, std::forward<Args>(args)...);
+      return 0;
+    }
+    if (sink.backtrace && (int)level >= (int)sink.backtrace->options().trigger)
+      writeBacktrace(sink);
+    return writeToSink(sink, 
+                       level, 
+                       formatString, 
+                       std::forward<Args>(args)...);
   }
 
 
   template<typename... Args>
-  void log(Level level, 
-           const char* formatString, 
-           Args&&... args) {
-    log(detail::kDefaultSinkId, level, formatString, std::forward<Args>(args)...);
+  size_t log(Level level, 
+             const char* formatString, 
+             Args&&... args) {
+    return log(detail::kDefaultSinkId, level, formatString, std::forward<Args>(args)...);
   }
 
   void setTimeFormat(const std::string& timeFormatStr);
@@ -114,24 +194,66 @@ private:
   SinkMapConstIterator getSinkById(int sinkId) const;
   SinkMapIterator getSinkById(int sinkId);
   void checkSinkWithPattern(const std::string& fileName) const;
+  detail::AsyncWriterPtr createWriter(const Sink& sink, const SinkOptions& options) const;
+  static SinkStats sinkStats(const Sink& sink);
+  void scheduleStats(Sink& sink, int64_t interval, const std::string& timeFormat);
+  void writeStats(Sink& sink, const std::string& timeFormat);
+  void flushRepeats(Sink& sink);
+  /* Should be called with m_sinksMutex locked */
+  void writeBacktrace(Sink& sink);
+  /* loggedAt is ts::steadyNs() of the log call, 0 - not measured. hash is
+     RepeatFilter::hash of the message, 0 - not checked for repeats. */
+  void writeRecord(Sink& sink, Level level, int64_t timestamp, std::string data,
+                   int64_t loggedAt = 0, uint64_t hash = 0);
+  void writeMeasured(Sink& sink, Level level, int64_t timestamp, const std::string& data,
+                     int64_t loggedAt, uint64_t hash);
+  void pushRecord(Sink& sink, Level level, int64_t timestamp, std::string data,
+                  int64_t loggedAt = 0, uint64_t hash = 0);
+  void record(Sink& sink, Level level, int64_t timestamp, const std::string& message);
 
   template<typename... Args>
-  void writeToSink(Sink& sink, 
+  void captureBelowLevel(Sink& sink, 
+                         Level level,
+                         const char* formatString, 
+                         Args&&... args) {
+    bool toBacktrace = sink.backtrace && sink.backtrace->captures(level);
+    bool toRecorder = sink.recorder && (int)level >= (int)sink.recorderLevel;
+    if (!toBacktrace && !toRecorder)
+      return;
+
+    std::stringstream messageStream;
+    auto timestamp = detail::ts::now();
+    detail::fmt(messageStream, formatString, std::forward<Args>(args)...);
+    auto message = messageStream.str();
+    if (toBacktrace)
+      sink.backtrace->push(timestamp, level, message);
+    if (toRecorder)
+      record(sink, level, timestamp, message);
+  }
+
+  template<typename... Args>
+  size_t writeToSink(Sink& sink, 
                    Level level,
                    const char* formatString, 
                    Args&&... args) {
+    auto loggedAt = sink.latency ? detail::ts::steadyNs() : 0;
     std::stringstream messageStream;
-    detail::writeLogData(messageStream, level, m_timeFormat);
+    auto timestamp = detail::ts::now();
+    detail::writeLogData(messageStream, level, m_timeFormat, timestamp,
+                         sink.writer ? sink.writer->nextSequence() : 0);
+    auto messageStart = (size_t)messageStream.tellp();
     detail::fmt(messageStream, 
                 formatString, 
                 std::forward<Args>(args)...);
     messageStream << std::endl << std::endl;
-    std::lock_guard<std::mutex> lock(*sink.mutex);
-    auto outString = messageStream.str();
-    sink.fileManager->write(outString.data(), outString.size());
-    if (sink.duplicateToStdout) {
-      std::cout << outString;
-    }
+    auto data = messageStream.str();
+    auto size = data.size();
+    auto hash = sink.repeats ? 
+        detail::RepeatFilter::hash(data.data() + messageStart, size - messageStart) : 0;
+    if (sink.latency)
+      sink.latency->format.add(detail::ts::steadyNs() - loggedAt);
+    writeRecord(sink, level, timestamp, std::move(data), loggedAt, hash);
+    return size;
   }
 
 private:
@@ -144,23 +266,92 @@ private:
 
 #define ___LOG_EXPAND(...) __VA_ARGS__
 
+/* With SL_PROFILE_CALL_SITES defined before including this header every
+   LOG and LOG_S statement counts its records, see sl::topCallSites */
+#if defined (SL_PROFILE_CALL_SITES)
+  #define ___LOG_SITE(___formatStr) \
+    static sl::detail::CallSite ___site(__FILE__, __LINE__, ___formatStr)
+  #define ___LOG_SITE_HIT(___bytes) ___site.hit(___bytes)
+  #define ___LOG_SITE_FILTERED() ___site.filtered()
+#else
+  #define ___LOG_SITE(___formatStr) do {} while(0)
+  #define ___LOG_SITE_HIT(___bytes) (void)(___bytes)
+  #define ___LOG_SITE_FILTERED() do {} while(0)
+#endif
+
 #define LOG_S(___sinkId, ___level, ___formatStr, ...) \
   do { \
-    if ((int)sl::Logger::getLogger().getLevel(___sinkId) <= (int)___level) { \
-      sl::Logger::getLogger().log(___sinkId,  \
-                                  (sl::Level)___level,  \
-                                  ___formatStr, \
-                                  ___LOG_EXPAND(__VA_ARGS__)); \
+    ___LOG_SITE(___formatStr); \
+    if (sl::Logger::getLogger().isEnabled(___sinkId, (sl::Level)___level)) { \
+      ___LOG_SITE_HIT(sl::Logger::getLogger().log(___sinkId,  \
+                                                  (sl::Level)___level,  \
+                                                  ___formatStr, \
+                                                  ___LOG_EXPAND(__VA_ARGS__))); \
+    } else { \
+      ___LOG_SITE_FILTERED(); \
     } \
   } while(0)
   
 
 #define LOG(___level, ___formatStr, ...) \
   do { \
-    if ((int)sl::Logger::getLogger().getDefaultLevel() <= (int)___level) { \
-      sl::Logger::getLogger().log((sl::Level)___level,  \
-                                  ___formatStr, \
-                                  ___LOG_EXPAND(__VA_ARGS__)); \
+    ___LOG_SITE(___formatStr); \
+    if (sl::Logger::getLogger().isDefaultEnabled((sl::Level)___level)) { \
+      ___LOG_SITE_HIT(sl::Logger::getLogger().log((sl::Level)___level,  \
+                                                  ___formatStr, \
+                                                  ___LOG_EXPAND(__VA_ARGS__))); \
+    } else { \
+      ___LOG_SITE_FILTERED(); \
     } \
   } while(0)
 
+/* Limited variants, the limiter is consulted only for the records of an
+   enabled level and before they are formatted. The first record let
+   through after some have been suppressed by LOG_EVERY_T or
+   LOG_RATE_LIMITED is preceded by a "sl: N records suppressed" one. */
+#define ___LOG_LIMITED(___sinkId, ___limiter, ___level, ___formatStr, ...) \
+  do { \
+    ___LOG_SITE(___formatStr); \
+    static sl::detail::___limiter; \
+    uint64_t ___suppressed = 0; \
+    auto& ___logger = sl::Logger::getLogger(); \
+    if (___logger.isEnabled(___sinkId, (sl::Level)(___level)) && \
+        ___state.allow(___suppressed)) { \
+      if (___suppressed != 0) { \
+        ___logger.log(___sinkId, (sl::Level)(___level), "sl: % records suppressed", \
+                      std::to_string(___suppressed)); \
+      } \
+      ___LOG_SITE_HIT(___logger.log(___sinkId,  \
+                                    (sl::Level)(___level),  \
+                                    ___formatStr, \
+                                    ___LOG_EXPAND(__VA_ARGS__))); \
+    } else { \
+      ___LOG_SITE_FILTERED(); \
+    } \
+  } while(0)
+
+/* The 1st, n+1th, 2n+1th... records of the statement */
+#define LOG_S_EVERY_N(___sinkId, ___n, ___level, ___formatStr, ...) \
+  ___LOG_LIMITED(___sinkId, EveryN ___state(___n), ___level, ___formatStr, __VA_ARGS__)
+#define LOG_EVERY_N(___n, ___level, ___formatStr, ...) \
+  LOG_S_EVERY_N(sl::detail::kDefaultSinkId, ___n, ___level, ___formatStr, __VA_ARGS__)
+
+/* The first n records of the statement */
+#define LOG_S_FIRST_N(___sinkId, ___n, ___level, ___formatStr, ...) \
+  ___LOG_LIMITED(___sinkId, FirstN ___state(___n), ___level, ___formatStr, __VA_ARGS__)
+#define LOG_FIRST_N(___n, ___level, ___formatStr, ...) \
+  LOG_S_FIRST_N(sl::detail::kDefaultSinkId, ___n, ___level, ___formatStr, __VA_ARGS__)
+
+/* At most one record of the statement per ___ms milliseconds */
+#define LOG_S_EVERY_T(___sinkId, ___ms, ___level, ___formatStr, ...) \
+  ___LOG_LIMITED(___sinkId, EveryT ___state(___ms), ___level, ___formatStr, __VA_ARGS__)
+#define LOG_EVERY_T(___ms, ___level, ___formatStr, ...) \
+  LOG_S_EVERY_T(sl::detail::kDefaultSinkId, ___ms, ___level, ___formatStr, __VA_ARGS__)
+
+/* Bursts of up to ___burst records, ___perSecond records a second on average */
+#define LOG_S_RATE_LIMITED(___sinkId, ___perSecond, ___burst, ___level, ___formatStr, ...) \
+  ___LOG_LIMITED(___sinkId, RateLimit ___state(___perSecond, ___burst), \
+                 ___level, ___formatStr, __VA_ARGS__)
+#define LOG_RATE_LIMITED(___perSecond, ___burst, ___level, ___formatStr, ...) \
+  LOG_S_RATE_LIMITED(sl::detail::kDefaultSinkId, ___perSecond, ___burst, \
+                     ___level, ___formatStr, __VA_ARGS__)
@@ -1,8 +1,11 @@
 #include <algorithm>
 #include <string.h>
+#include <errno.h>
 #include <log/log_files_manager.h>
 #include <log/utils.h>
 #include <log/format.h>
+#include <log/lz.h>
+#include <log/archive.h>
 
 namespace sl {
 namespace detail {
@@ -10,13 +13,84 @@ namespace detail {
 LogFilesManager::LogFilesManager(int64_t totalLimit,
                                  int64_t fileLimit,
                                  FileEntryCatalogPtr catalog)
-  : m_limitWatcher(totalLimit, fileLimit, this),
-    m_catalog(std::move(catalog))
+  : LogFilesManager(std::move(catalog), SinkOptions(totalLimit, fileLimit))
 {
+}
+
+LogFilesManager::LogFilesManager(FileEntryCatalogPtr catalog,
+                                 const SinkOptions& options)
+  : m_limitWatcher(options.totalLimit, options.fileLimit, this, options.rotation),
+    m_rotationPolicy(options.rotation.policy),
+    m_retention(options.retention),
+    m_compression(options.compression),
+    m_compressionThreads(options.compressionThreads),
+    m_activeSize(0),
+    m_catalog(std::move(catalog)),
+    m_durability(options.durability),
+    m_errorOptions(options.errors),
+    m_retryInterval(0),
+    m_spilledBytes(0),
+    m_spillFailed(false),
+    m_retentionDeadline(-1),
+    m_retentionPending(false),
+    m_activeFd(-1),
+    m_housekeeperThread(options.housekeeperThread),
+    m_compressorThread(options.compressorThread)
+{
+  if (m_durability.mode == Durability::periodic && m_durability.interval <= 0) {
+    throw std::runtime_error(sl::fmt("%: invalid sync interval %", 
+                                     __FUNCTION__, m_durability.interval));
+  }
+
   m_stream = m_catalog->first().open();
   m_stream->close();
+  m_activeSize = m_catalog->first().size();
   m_limitWatcher.setSize(m_catalog->totalBytes());
+  m_limitWatcher.setActiveFile(m_catalog->first().size(), 
+                               m_catalog->first().lastModified());
   m_stream->open();
+  m_activeFd = m_stream->fd();
+
+  if (retentionEnabled()) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    scheduleRetention(0);
+  }
+
+  if (m_durability.mode == Durability::periodic)
+    schedulePeriodicSync();
+
+  if (m_compression != Compression::none) {
+    m_compressor.reset(new Worker(m_compressorThread));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto id: m_catalog->rotatedIds()) {
+      /* compressed, but not renamed before the process has stopped */
+      auto entry = m_catalog->findRotated(id);
+      if (entry && !str::endsWith(entry->name(), lz::kCompressedExtension) &&
+          ArchiveReader::isArchive(entry->name())) {
+        renameArchive(*entry);
+        continue;
+      }
+      scheduleCompression(id, BlockMarks());
+    }
+  }
+}
+
+LogFilesManager::~LogFilesManager() {
+  m_activeFd = -1;
+  /* Stopped before being reset since running tasks may post new ones */
+  if (m_compressor)
+    m_compressor->stop();
+  if (m_housekeeper)
+    m_housekeeper->stop();
+  m_compressor.reset();
+  m_housekeeper.reset();
+
+  if (m_durability.mode != Durability::none) {
+    try {
+      syncActive();
+    } catch (...) {
+    }
+  }
 }
 
 std::string LogFilesManager::baseName() const {
@@ -27,27 +101,366 @@ int64_t LogFilesManager::clearNeeded() {
   if (m_catalog->empty())
     return 0;
 
+  std::lock_guard<std::mutex> syncLock(m_syncMutex);
+  auto start = ts::steadyNs();
+  m_activeFd = -1;
   if (m_stream)
     m_stream->close();
 
   auto result = m_catalog->removeLast();
   m_stream = m_catalog->first().open();
+  m_activeFd = m_stream->fd();
+  if (m_catalog->size() == 1) {
+    m_activeSize = 0;
+    m_blockMarks.clear();
+  }
 
+  ++m_stats.deletions;
+  m_stats.rotationTime += ts::steadyNs() - start;
   return result;
 }
 
 void LogFilesManager::nextFile() {
+  std::lock_guard<std::mutex> syncLock(m_syncMutex);
+  auto start = ts::steadyNs();
+  if (m_durability.mode != Durability::none)
+    m_stream->sync();
+  m_activeFd = -1;
   m_stream->close();
-  m_catalog->rotate();
+  if (m_rotationPolicy == RotationPolicy::size) {
+    m_catalog->rotate();
+  } else {
+    m_catalog->rotate(m_limitWatcher.periodStart());
+  }
   m_stream = m_catalog->first().open();
+  m_activeFd = m_stream->fd();
+
+  if (retentionEnabled())
+    scheduleRetention(0);
+
+  if (m_compression != Compression::none)
+    scheduleCompression(m_catalog->rotatedIds().front(), std::move(m_blockMarks));
+  m_blockMarks.clear();
+  m_activeSize = 0;
+  ++m_stats.rotations;
+  m_stats.rotationTime += ts::steadyNs() - start;
+}
+
+bool LogFilesManager::retentionEnabled() const {
+  return m_retention.maxAge != 0 || m_retention.maxFiles != 0;
+}
+
+/* Should be called with m_mutex locked. at is in seconds since epoch, 0 means
+   a check right now, at most one of them is pending. An armed age check is
+   never earlier than needed (rotations only add newer files), so it is kept
+   and reschedules itself from the oldest file when it runs. */
+void LogFilesManager::scheduleRetention(int64_t at) {
+  if (at == 0) {
+    if (m_retentionPending)
+      return;
+
+    m_retentionPending = true;
+    housekeeper().post([this] { enforceRetention(false); });
+    return;
+  }
+
+  if (m_retentionDeadline != -1)
+    return;
+
+  auto delay = std::max<int64_t>(0, at - ts::now() / 1000000);
+  m_retentionDeadline = at;
+  housekeeper().post([this] { enforceRetention(true); },
+                      std::chrono::seconds(delay));
+}
+
+void LogFilesManager::enforceRetention(bool delayed) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto now = ts::now() / 1000000;
+
+  if (delayed)
+    m_retentionDeadline = -1;
+  else
+    m_retentionPending = false;
+  auto files = m_catalog->size();
+  if (m_catalog->removeExpired(now, m_retention.maxAge, m_retention.maxFiles) != 0) 
+    m_limitWatcher.setSize(m_catalog->totalBytes());
+  m_stats.deletions += files - m_catalog->size();
+
+  auto oldest = m_catalog->oldestTime();
+  if (m_retention.maxAge != 0 && oldest != -1)
+    scheduleRetention(std::max(oldest + m_retention.maxAge, now + 1));
+}
+
+/* Should be called with m_mutex locked */
+void LogFilesManager::scheduleCompression(uint64_t id, BlockMarks marks) {
+  auto entry = m_catalog->findRotated(id);
+  if (!entry || str::endsWith(entry->name(), lz::kCompressedExtension))
+    return;
+
+  auto sharedMarks = std::make_shared<BlockMarks>(std::move(marks));
+  m_compressor->post([this, id, sharedMarks] { compressRotated(id, *sharedMarks); });
+}
+
+/* The file is compressed to a temporary one without holding the lock, which
+   then atomically replaces the original, if it's still there, and takes its
+   name with the compressed extension appended. An archive left with the
+   plain name is renamed on the next start rather than compressed again. */
+void LogFilesManager::compressRotated(uint64_t id, const BlockMarks& marks) {
+  using FilePtr = std::unique_ptr<FILE, int(*)(FILE*)>;
+  FilePtr in(nullptr, fclose);
+  std::string tmpName;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_catalog->findRotated(id);
+    if (!entry)
+      return;
+
+    /* Renames done by rotation don't affect the opened file */
+    in.reset(fopen(entry->name().c_str(), "rb"));
+    if (!in)
+      return;
+    tmpName = str::join(entry->name(), lz::kCompressedExtension, kTmpFileExtension);
+  }
+
+  int64_t size;
+  try {
+    size = writeArchive(in.get(), tmpName, marks, m_compressionThreads, 
+                        m_compressorThread);
+  } catch (const std::exception&) {
+    ::remove(tmpName.c_str());
+    throw;
+  }
+  in.reset();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = m_catalog->findRotated(id);
+  if (!entry || ::rename(tmpName.c_str(), entry->name().c_str()) != 0) {
+    ::remove(tmpName.c_str());
+    return;
+  }
+
+  m_catalog->setRotatedSize(id, size);
+  m_limitWatcher.setSize(m_catalog->totalBytes());
+  renameArchive(*entry);
+}
+
+/* Should be called with m_mutex locked. The entry keeps its name if the
+   rename fails, so the catalog still matches the disk. */
+void LogFilesManager::renameArchive(IFileEntry& entry) {
+  try {
+    entry.rename(str::join(entry.name(), lz::kCompressedExtension));
+  } catch (const std::exception&) {
+  }
+}
+
+void LogFilesManager::flush(bool sync) {
+  if (!sync)
+    return;
+
+  try {
+    m_syncBarrier.run([this] { syncActive(); });
+  } catch (const std::exception& e) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    fail(e.what(), EIO);
+  }
+}
+
+SinkErrorStats LogFilesManager::errorStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_errorStats;
+}
+
+SinkStats LogFilesManager::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto result = m_stats;
+  result.dropped = m_errorStats.dropped;
+  result.writeErrors = m_errorStats.errors;
+  return result;
+}
+
+void LogFilesManager::schedulePeriodicSync() {
+  housekeeper().post([this] {
+                        schedulePeriodicSync();
+                        flush(true);
+                      },
+                      std::chrono::milliseconds(m_durability.interval));
+}
+
+/* Writers hold only m_mutex, so they are not blocked by the sync */
+void LogFilesManager::syncActive() {
+  std::lock_guard<std::mutex> lock(m_syncMutex);
+  if (m_stream && m_stream->isOpened())
+    m_stream->sync();
+}
+
+/* Created on demand, should be called with m_mutex locked or before the
+   manager is shared */
+Worker& LogFilesManager::housekeeper() {
+  if (!m_housekeeper)
+    m_housekeeper.reset(new Worker(m_housekeeperThread));
+
+  return *m_housekeeper;
+}
+
+void LogFilesManager::write(const void* data, size_t size, int64_t timestamp) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_errorStats.degraded) {
+    divert(data, size);
+    return;
+  }
+
+  bool written = false;
+  try {
+    m_limitWatcher.checkTime(timestamp);
+    int error = writeActive(data, size, timestamp);
+    if (error != 0) {
+      fail(sl::fmt("write to % failed: %", m_catalog->first().name(), strerror(error)),
+           error);
+      divert(data, size);
+      return;
+    }
+
+    written = true;
+    m_limitWatcher.addWritten(size);
+  } catch (const std::exception& e) {
+    /* rotation failures, errno is still the one of the failed call */
+    fail(e.what(), errno);
+    if (!written)
+      divert(data, size);
+  }
 }
 
-void LogFilesManager::write(const void* data, size_t size) {
+int LogFilesManager::writeActive(const void* data, size_t size, int64_t timestamp) {
   if (!m_stream || !m_stream->isOpened()) 
-    throw std::runtime_error(sl::fmt("%: no stream", __FUNCTION__));
+    return EBADF;
+
+  if (m_compression != Compression::none && 
+      (m_blockMarks.empty() || 
+       m_activeSize - m_blockMarks.back().offset >= (int64_t)kArchiveBlockSize)) {
+    m_blockMarks.emplace_back(m_activeSize, timestamp);
+  }
+
+  auto start = ts::steadyNs();
+  int error = m_stream->write(data, size);
+  m_stats.writeTime += ts::steadyNs() - start;
+  if (error == 0) {
+    m_activeSize += size;
+    ++m_stats.written;
+    m_stats.bytes += size;
+  }
+
+  return error;
+}
+
+/* Should be called with m_mutex locked */
+void LogFilesManager::fail(const std::string& message, int code) {
+  ++m_errorStats.errors;
+  if (m_errorStats.degraded)
+    return;
+
+  m_errorStats.degraded = true;
+  m_failureStart = m_errorStats;
+  m_retryInterval = std::max<int64_t>(1, m_errorOptions.retryInterval);
+  notify(message, code, false);
+  scheduleRecovery();
+}
+
+void LogFilesManager::divert(const void* data, size_t size) {
+  if (spill(data, size)) {
+    ++m_errorStats.spilled;
+  } else {
+    ++m_errorStats.dropped;
+  }
+}
+
+bool LogFilesManager::spill(const void* data, size_t size) {
+  if (m_errorOptions.spillDir.empty() || m_spillFailed)
+    return false;
+
+  if (m_errorOptions.spillLimit != 0 && 
+      m_spilledBytes + (int64_t)size > m_errorOptions.spillLimit) {
+    return false;
+  }
+
+  if (!m_spillStream) {
+    try {
+      m_spillStream.reset(new FileStream(
+          fs::join(m_errorOptions.spillDir, 
+                   str::join(baseName(), ".spill", kLogFileExtension))));
+    } catch (const std::exception&) {
+      m_spillFailed = true;
+      return false;
+    }
+  }
+
+  if (m_spillStream->write(data, size) != 0) {
+    m_spillFailed = true;
+    return false;
+  }
+
+  m_spilledBytes += size;
+  return true;
+}
+
+void LogFilesManager::scheduleRecovery() {
+  housekeeper().post([this] { recover(); }, 
+                     std::chrono::milliseconds(m_retryInterval));
+}
+
+/* Reopens the active file and writes a notice about the lost records into
+   it. Retried with backoff until it succeeds. */
+void LogFilesManager::recover() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_errorStats.degraded)
+    return;
+
+  int error;
+  try {
+    {
+      std::lock_guard<std::mutex> syncLock(m_syncMutex);
+      m_activeFd = -1;
+      m_stream.reset();
+      m_stream = m_catalog->first().open();
+      m_activeFd = m_stream->fd();
+    }
+
+    auto notice = sl::fmt("sl: % recovered after an error, % records dropped, % spilled\n\n",
+                          baseName(),
+                          m_errorStats.dropped - m_failureStart.dropped,
+                          m_errorStats.spilled - m_failureStart.spilled);
+    error = writeActive(notice.data(), notice.size(), ts::now());
+    if (error == 0)
+      m_limitWatcher.addWritten(notice.size());
+  } catch (const std::exception&) {
+    error = errno != 0 ? errno : EIO;
+  }
+
+  if (error != 0) {
+    ++m_errorStats.errors;
+    m_retryInterval = std::min(m_retryInterval * 2, 
+                               std::max(m_retryInterval, m_errorOptions.maxRetryInterval));
+    scheduleRecovery();
+    return;
+  }
+
+  m_errorStats.degraded = false;
+  m_spillStream.reset();
+  m_spilledBytes = 0;
+  m_spillFailed = false;
+  notify(std::string(), 0, true);
+}
+
+/* The handler is called on the housekeeper so that it never runs on the
+   logging thread or under the manager lock */
+void LogFilesManager::notify(const std::string& message, int code, bool recovered) {
+  if (!m_errorOptions.handler)
+    return;
 
-  m_stream->write(data, size);
-  m_limitWatcher.addWritten(size);
+  auto handler = m_errorOptions.handler;
+  SinkError error{baseName(), message, code, recovered};
+  housekeeper().post([handler, error] { handler(error); });
 }
 
 }
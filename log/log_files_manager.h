@@ -3,11 +3,17 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <log/rotation_limit_watcher_handler.h>
 #include <log/rotation_limit_watcher.h>
 #include <log/file_entry.h>
 #include <log/file_entry_catalog.h>
 #include <log/file_stream.h>
+#include <log/sink_options.h>
+#include <log/worker.h>
+#include <log/archive.h>
+#include <log/flush_barrier.h>
 
 namespace sl {
 namespace detail {
@@ -18,21 +24,86 @@ public:
   LogFilesManager(int64_t totalLimit,
                   int64_t fileLimit,
                   FileEntryCatalogPtr catalog);
+  LogFilesManager(FileEntryCatalogPtr catalog, const SinkOptions& options);
+  ~LogFilesManager();
 
-  void write(const void* data, size_t size);
+  /* timestamp is the record time, microseconds since epoch */
+  /* Doesn't throw, I/O errors switch the manager to the degraded mode where
+     records are spilled or dropped until the sink is reopened. */
+  void write(const void* data, size_t size, int64_t timestamp);
+  /* Writes are unbuffered, so only the sync part does anything here. Files
+     rotated out before the call are synced only if durability is on. Sync
+     errors are handled as write errors. */
+  void flush(bool sync);
+  SinkErrorStats errorStats() const;
+  /* The file counters, errors and the records dropped while failing */
+  SinkStats stats() const;
   std::string baseName() const;
+  /* For the fatal signal handler, -1 while the active file is being
+     replaced */
+  int activeFd() const { return m_activeFd; }
 
 protected:
   const FileStreamPtr& stream() const { return m_stream; }
+  const Worker* housekeeperWorker() const { return m_housekeeper.get(); }
   
 private:
   virtual int64_t clearNeeded() override;
   virtual void nextFile() override;
 
+  bool retentionEnabled() const;
+  void scheduleRetention(int64_t at);
+  void enforceRetention(bool delayed);
+  void scheduleCompression(uint64_t id, BlockMarks marks);
+  void compressRotated(uint64_t id, const BlockMarks& marks);
+  void renameArchive(IFileEntry& entry);
+  void schedulePeriodicSync();
+  void syncActive();
+  Worker& housekeeper();
+
+  int writeActive(const void* data, size_t size, int64_t timestamp);
+  void fail(const std::string& message, int code);
+  void divert(const void* data, size_t size);
+  bool spill(const void* data, size_t size);
+  void scheduleRecovery();
+  void recover();
+  void notify(const std::string& message, int code, bool recovered);
+
 private:
   RotationLimitWatcher m_limitWatcher;
+  RotationPolicy m_rotationPolicy;
+  RetentionOptions m_retention;
+  Compression m_compression;
+  size_t m_compressionThreads;
+  /* Record offsets of the active file for the archive index */
+  BlockMarks m_blockMarks;
+  int64_t m_activeSize;
   FileEntryCatalogPtr m_catalog;
   FileStreamPtr m_stream;
+  mutable std::mutex m_mutex;
+  /* Taken after m_mutex whenever m_stream is reopened or replaced, so the
+     active file can be synced without stalling writers */
+  std::mutex m_syncMutex;
+  DurabilityOptions m_durability;
+  FlushBarrier m_syncBarrier;
+  ErrorOptions m_errorOptions;
+  SinkErrorStats m_errorStats;
+  SinkStats m_stats;
+  /* Counters at the moment the current failure has started */
+  SinkErrorStats m_failureStart;
+  int64_t m_retryInterval;
+  FileStreamPtr m_spillStream;
+  int64_t m_spilledBytes;
+  bool m_spillFailed;
+  /* Due time of the armed age check, -1 if none. Only the armed task
+     reposts it, the checks after rotations run once. */
+  int64_t m_retentionDeadline;
+  bool m_retentionPending;
+  std::atomic<int> m_activeFd;
+  ThreadOptions m_housekeeperThread;
+  ThreadOptions m_compressorThread;
+  WorkerPtr m_housekeeper;
+  WorkerPtr m_compressor;
 };
 
 using LogFilesManagerPtr = std::unique_ptr<LogFilesManager>;
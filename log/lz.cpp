@@ -0,0 +1,164 @@
+#include <string.h>
+#include <vector>
+#include <log/lz.h>
+
+namespace sl {
+namespace detail {
+namespace lz {
+
+namespace {
+
+const int kHashLog = 12;
+const size_t kMinMatch = 4;
+const size_t kLastLiterals = 5;
+const size_t kMatchFindLimit = 12;
+const size_t kMaxOffset = 65535;
+
+uint32_t read32(const uint8_t* p) {
+  uint32_t result;
+  memcpy(&result, p, sizeof(result));
+  return result;
+}
+
+uint32_t hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+uint8_t* writeLength(uint8_t* op, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = (uint8_t)length;
+  return op;
+}
+
+uint8_t* writeSequence(uint8_t* op,
+                       const uint8_t* literals,
+                       size_t literalLength,
+                       size_t offset,
+                       size_t matchLength) {
+  uint8_t* token = op++;
+  *token = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+  if (literalLength >= 15)
+    op = writeLength(op, literalLength - 15);
+
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+  if (matchLength == 0)
+    return op;
+
+  *op++ = (uint8_t)(offset & 0xff);
+  *op++ = (uint8_t)(offset >> 8);
+  matchLength -= kMinMatch;
+  *token |= (uint8_t)(matchLength < 15 ? matchLength : 15);
+  if (matchLength >= 15)
+    op = writeLength(op, matchLength - 15);
+
+  return op;
+}
+
+bool readLength(const uint8_t** ip, const uint8_t* end, size_t* length) {
+  uint8_t byte;
+  do {
+    if (*ip >= end)
+      return false;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+
+  return true;
+}
+
+}
+
+size_t compressBound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+size_t compress(const char* src, size_t size, char* dst) {
+  const uint8_t* const base = (const uint8_t*)src;
+  const uint8_t* const end = base + size;
+  const uint8_t* ip = base;
+  const uint8_t* anchor = base;
+  uint8_t* op = (uint8_t*)dst;
+
+  if (size > kMatchFindLimit) {
+    const uint8_t* const matchLimit = end - kLastLiterals;
+    const uint8_t* const findLimit = end - kMatchFindLimit;
+    std::vector<uint32_t> table(1 << kHashLog, 0);
+
+    while (ip < findLimit) {
+      uint32_t sequence = read32(ip);
+      uint32_t& slot = table[hash(sequence)];
+      const uint8_t* ref = base + slot;
+      slot = (uint32_t)(ip - base);
+
+      if (ref >= ip || (size_t)(ip - ref) > kMaxOffset || read32(ref) != sequence) {
+        ++ip;
+        continue;
+      }
+
+      const uint8_t* matchStart = ip;
+      size_t offset = ip - ref;
+      ip += kMinMatch;
+      ref += kMinMatch;
+      while (ip < matchLimit && *ip == *ref) {
+        ++ip;
+        ++ref;
+      }
+
+      op = writeSequence(op, anchor, matchStart - anchor, offset, ip - matchStart);
+      anchor = ip;
+    }
+  }
+
+  op = writeSequence(op, anchor, end - anchor, 0, 0);
+  return op - (uint8_t*)dst;
+}
+
+bool decompress(const char* src, size_t size, char* dst, size_t rawSize) {
+  const uint8_t* ip = (const uint8_t*)src;
+  const uint8_t* const end = ip + size;
+  uint8_t* op = (uint8_t*)dst;
+  uint8_t* const outEnd = op + rawSize;
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !readLength(&ip, end, &literalLength))
+      return false;
+    if ((size_t)(end - ip) < literalLength || (size_t)(outEnd - op) < literalLength)
+      return false;
+
+    memcpy(op, ip, literalLength);
+    ip += literalLength;
+    op += literalLength;
+    if (ip == end)
+      break;
+
+    if (end - ip < 2)
+      return false;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - (uint8_t*)dst))
+      return false;
+
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(&ip, end, &matchLength))
+      return false;
+    matchLength += kMinMatch;
+    if ((size_t)(outEnd - op) < matchLength)
+      return false;
+
+    const uint8_t* ref = op - offset;
+    for (size_t i = 0; i < matchLength; ++i) {
+      *op++ = *ref++;
+    }
+  }
+
+  return op == outEnd;
+}
+
+}
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace sl {
+namespace detail {
+
+/* LZ77 block codec (LZ4-like sequences: token, literals, 16 bit offset, match
+   length) */
+namespace lz {
+
+const std::string kCompressedExtension = ".lz";
+
+size_t compressBound(size_t size);
+
+/* dst should have room for compressBound(size) bytes. Returns the
+   compressed size. */
+size_t compress(const char* src, size_t size, char* dst);
+
+/* rawSize is the exact decompressed size. Returns false if the data is
+   corrupted. */
+bool decompress(const char* src, size_t size, char* dst, size_t rawSize);
+
+}
+}
+}
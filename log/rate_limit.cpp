@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <log/rate_limit.h>
+#include <log/utils.h>
+
+namespace sl {
+namespace detail {
+
+constexpr int64_t RateLimit::kMaxSpan;
+
+bool EveryT::allow(uint64_t& suppressed) {
+  auto now = ts::steadyNs();
+  auto next = m_next.load(std::memory_order_relaxed);
+  if (now < next || 
+      !m_next.compare_exchange_strong(next, now + m_interval, std::memory_order_relaxed)) {
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+bool RateLimit::allow(uint64_t& suppressed) {
+  auto now = ts::steadyNs();
+  auto full = m_full.load(std::memory_order_relaxed);
+  while (true) {
+    auto start = std::max(full, now);
+    /* taking a token moves the full time an interval further */
+    if (start - now > m_tolerance) {
+      m_suppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (m_full.compare_exchange_weak(full, start + m_interval, std::memory_order_relaxed))
+      break;
+  }
+
+  suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+namespace sl {
+namespace detail {
+
+/* Per statement state of the LOG_EVERY_N, LOG_FIRST_N, LOG_EVERY_T and
+   LOG_RATE_LIMITED macros, function local statics. allow() decides before
+   anything is formatted; when it lets a record through after skipping
+   some, suppressed is set to their number. */
+
+class EveryN {
+public:
+  constexpr explicit EveryN(uint64_t n) : m_n(n == 0 ? 1 : n), m_count(0) {}
+
+  /* The 1st, n+1th, 2n+1th... calls, the skipped ones are implied */
+  bool allow(uint64_t& suppressed) {
+    suppressed = 0;
+    return m_count.fetch_add(1, std::memory_order_relaxed) % m_n == 0;
+  }
+
+private:
+  const uint64_t m_n;
+  std::atomic<uint64_t> m_count;
+};
+
+class FirstN {
+public:
+  constexpr explicit FirstN(uint64_t n) : m_n(n), m_count(0) {}
+
+  bool allow(uint64_t& suppressed) {
+    suppressed = 0;
+    /* no more writes to the shared line once the limit is reached */
+    if (m_count.load(std::memory_order_relaxed) >= m_n)
+      return false;
+    return m_count.fetch_add(1, std::memory_order_relaxed) < m_n;
+  }
+
+private:
+  const uint64_t m_n;
+  std::atomic<uint64_t> m_count;
+};
+
+/* At most one record per interval ms */
+class EveryT {
+public:
+  constexpr explicit EveryT(int64_t interval) : 
+    m_interval(interval * 1000000), 
+    m_next(0), 
+    m_suppressed(0) {}
+
+  bool allow(uint64_t& suppressed);
+
+private:
+  const int64_t m_interval;
+  std::atomic<int64_t> m_next; /* ts::steadyNs() */
+  std::atomic<uint64_t> m_suppressed;
+};
+
+/* Token bucket of burst tokens refilled at rate per second, kept as the
+   time the bucket gets full (GCRA) so one atomic holds the whole state.
+   rate <= 0 - burst records and no refill. The bucket spans at most
+   kMaxSpan, so the times never overflow. */
+class RateLimit {
+public:
+  static constexpr int64_t kMaxSpan = INT64_MAX / 4; /* ns, ~73 years */
+
+  constexpr RateLimit(double rate, uint64_t burst) : 
+    m_interval(interval(rate, burst)),
+    m_tolerance(tolerance(interval(rate, burst), burst)),
+    m_full(0),
+    m_suppressed(0) {}
+
+  bool allow(uint64_t& suppressed);
+
+private:
+  static constexpr int64_t interval(double rate, uint64_t burst) {
+    return rate <= 0 ? (burst <= 1 ? kMaxSpan : 
+                        burst >= (uint64_t)kMaxSpan ? 1 : kMaxSpan / (int64_t)burst) :
+           1e9 / rate >= (double)kMaxSpan ? kMaxSpan : 
+           (int64_t)(1e9 / rate);
+  }
+
+  /* interval * (burst - 1), saturated at kMaxSpan */
+  static constexpr int64_t tolerance(int64_t interval, uint64_t burst) {
+    return burst <= 1 || interval == 0 ? 0 :
+           burst - 1 >= (uint64_t)(kMaxSpan / interval) ? kMaxSpan :
+           interval * (int64_t)(burst - 1);
+  }
+
+private:
+  const int64_t m_interval;  /* ns per token */
+  const int64_t m_tolerance;
+  std::atomic<int64_t> m_full;
+  std::atomic<uint64_t> m_suppressed;
+};
+
+}
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <log/record_queue.h>
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+/* Bulk records taken at once while there is a priority lane, bounds the
+   wait of a priority record which comes in during a write */
+const size_t kBulkBatchSize = 64;
+
+}
+
+RecordQueue::RecordQueue(const AsyncOptions& options, Waiter* waiter)
+  : m_options(options),
+    m_waiter(waiter),
+    m_nextSeq(1),
+    m_inFlight(0),
+    m_inFlightLast(0),
+    m_inFlightPriority(false),
+    m_stopped(false),
+    m_unreported(0),
+    m_size(0)
+{
+}
+
+bool RecordQueue::isPriority(const Record& record) const {
+  return m_options.priorityQueueSize != 0 && 
+         (int)record.level >= (int)m_options.priorityLevel;
+}
+
+bool RecordQueue::push(Record record) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto dropped = m_stats.dropped;
+  bool priority = isPriority(record);
+  uint64_t seq = priority ? pushPriority(record) : 0;
+  bool inLane = seq != 0;
+
+  /* the lane is full, the record takes its chances in the main queue */
+  if (seq == 0)
+    seq = pushBulk(record, lock);
+  if (seq == 0)
+    return false;
+
+  if (priority && m_options.priorityFlush) {
+    m_done.wait(lock, [this, seq, inLane] { 
+      return (inLane ? laneWritten(seq) : pending() > seq) || m_stopped; 
+    });
+  }
+
+  return m_stats.dropped == dropped;
+}
+
+uint64_t RecordQueue::pushPriority(Record& record) {
+  if (m_priority.size() >= m_options.priorityQueueSize)
+    return 0;
+
+  admit(m_priority, record);
+  return record.seq;
+}
+
+/* Returns the sequence number of the record, 0 if it was dropped. The
+   records evicted in its favour are counted, but don't fail the push. */
+uint64_t RecordQueue::pushBulk(Record& record, std::unique_lock<std::mutex>& lock) {
+  if (m_records.size() < m_options.queueSize) {
+    admit(m_records, record);
+    return record.seq;
+  }
+
+  uint64_t result = 0;
+  switch (m_options.overflow) {
+    case OverflowPolicy::block: {
+      auto notFull = [this] { return m_records.size() < m_options.queueSize || m_stopped; };
+      ++m_stats.blocked;
+      if (m_options.blockTimeout < 0) {
+        m_notFull.wait(lock, notFull);
+      } else {
+        m_notFull.wait_for(lock, 
+                           std::chrono::milliseconds(m_options.blockTimeout), 
+                           notFull);
+      }
+      if (m_records.size() < m_options.queueSize) {
+        admit(m_records, record);
+        return record.seq;
+      }
+      break;
+    }
+    case OverflowPolicy::dropNewest:
+      break;
+    case OverflowPolicy::dropOldest:
+      {
+        std::lock_guard<SignalGuard> guard(m_lanesGuard);
+        m_records.pop_front();
+        updateSize();
+      }
+      admit(m_records, record);
+      result = record.seq;
+      break;
+    case OverflowPolicy::dropBelowLevel:
+      if ((int)record.level >= (int)m_options.keepLevel && 
+          evictBelow(m_options.keepLevel)) {
+        admit(m_records, record);
+        result = record.seq;
+      }
+      break;
+  }
+
+  ++m_stats.dropped;
+  ++m_unreported;
+  return result;
+}
+
+/* Removes the oldest record below level */
+bool RecordQueue::evictBelow(Level level) {
+  auto it = std::find_if(m_records.begin(), m_records.end(), 
+                         [level](const Record& r) { return (int)r.level < (int)level; });
+  if (it == m_records.end())
+    return false;
+
+  std::lock_guard<SignalGuard> guard(m_lanesGuard);
+  m_records.erase(it);
+  updateSize();
+  return true;
+}
+
+void RecordQueue::admit(RecordBatch& lane, Record& record) {
+  record.seq = m_nextSeq++;
+  {
+    std::lock_guard<SignalGuard> guard(m_lanesGuard);
+    lane.push_back(std::move(record));
+    updateSize();
+  }
+  ++m_stats.queued;
+  m_stats.maxDepth = std::max(m_stats.maxDepth, m_records.size() + m_priority.size());
+  if (m_waiter)
+    m_waiter->notify();
+}
+
+bool RecordQueue::tryPop(RecordBatch* batch) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return take(batch);
+}
+
+bool RecordQueue::empty() const {
+  return m_size.load(std::memory_order_acquire) == 0;
+}
+
+void RecordQueue::updateSize() {
+  m_size.store(m_records.size() + m_priority.size(), std::memory_order_release);
+}
+
+bool RecordQueue::take(RecordBatch* batch) {
+  batch->clear();
+  bool isPriorityBatch = !m_priority.empty();
+  {
+    std::lock_guard<SignalGuard> guard(m_lanesGuard);
+    if (isPriorityBatch) {
+      batch->swap(m_priority);
+    } else if (m_options.priorityQueueSize == 0 || m_records.size() <= kBulkBatchSize) {
+      batch->swap(m_records);
+    } else {
+      std::move(m_records.begin(), m_records.begin() + kBulkBatchSize, 
+                std::back_inserter(*batch));
+      m_records.erase(m_records.begin(), m_records.begin() + kBulkBatchSize);
+    }
+    updateSize();
+  }
+
+  if (batch->empty())
+    return false;
+
+  m_inFlight = batch->front().seq;
+  m_inFlightLast = batch->back().seq;
+  m_inFlightPriority = isPriorityBatch;
+  m_notFull.notify_all();
+  return true;
+}
+
+void RecordQueue::done(const RecordBatch& batch) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.written += batch.size();
+  m_inFlight = 0;
+  m_done.notify_all();
+}
+
+uint64_t RecordQueue::pending() const {
+  auto result = std::numeric_limits<uint64_t>::max();
+  if (m_inFlight != 0)
+    result = m_inFlight;
+  if (!m_records.empty())
+    result = std::min(result, m_records.front().seq);
+  if (!m_priority.empty())
+    result = std::min(result, m_priority.front().seq);
+
+  return result;
+}
+
+/* The lane is never evicted from, so a record which is neither in it nor
+   in the batch being written is written */
+bool RecordQueue::laneWritten(uint64_t seq) const {
+  if (!m_priority.empty() && m_priority.front().seq <= seq)
+    return false;
+
+  return !(m_inFlight != 0 && m_inFlightPriority && 
+           m_inFlight <= seq && seq <= m_inFlightLast);
+}
+
+void RecordQueue::waitDone() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto ticket = m_nextSeq - 1;
+
+  /* Evicted records are never seen by the consumer, so it's enough that
+     there are no older ones left in the queue or in the consumer hands */
+  m_done.wait(lock, [this, ticket] { return pending() > ticket || m_stopped; });
+}
+
+uint64_t RecordQueue::takeDropped() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_records.empty() || !m_priority.empty())
+    return 0;
+
+  auto result = m_unreported;
+  m_unreported = 0;
+  return result;
+}
+
+void RecordQueue::stop() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stopped = true;
+  m_notFull.notify_all();
+  m_done.notify_all();
+}
+
+QueueStats RecordQueue::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+}
+}
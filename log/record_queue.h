@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <log/level.h>
+#include <log/sink_options.h>
+#include <log/waiter.h>
+#include <log/signal_guard.h>
+
+namespace sl {
+namespace detail {
+
+struct Record {
+  std::string data;
+  int64_t timestamp;
+  Level level;
+  uint64_t seq;
+  /* ts::steadyNs() of the log call, of the push and of the writer thread
+     taking the record, 0 if the sink doesn't measure latency */
+  int64_t loggedAt;
+  int64_t queuedAt;
+  int64_t takenAt;
+  /* RepeatFilter::hash of the message, 0 - not checked for repeats */
+  uint64_t hash;
+
+  Record() : timestamp(0), level(Level::debug), seq(0), loggedAt(0), queuedAt(0), takenAt(0),
+             hash(0) {}
+
+  Record(std::string data, int64_t timestamp, Level level) :
+    data(std::move(data)),
+    timestamp(timestamp),
+    level(level),
+    seq(0),
+    loggedAt(0),
+    queuedAt(0),
+    takenAt(0),
+    hash(0) {}
+};
+
+using RecordBatch = std::deque<Record>;
+
+/* Bounded MPSC queue applying the overflow policy, with an optional
+   priority lane. Records get increasing sequence numbers on admission,
+   each lane keeps them in order. */
+class RecordQueue {
+public:
+  /* waiter, if any, is notified of every admitted record */
+  RecordQueue(const AsyncOptions& options, Waiter* waiter = nullptr);
+
+  /* Returns false if the record (or the one it has evicted) was dropped.
+     Waits for priority records to be written if priorityFlush is set. */
+  bool push(Record record);
+  /* Moves the priority records or, if there are none, the others to
+     batch. Doesn't wait, returns false if there is nothing to take. The
+     consumer waits with the Waiter. */
+  bool tryPop(RecordBatch* batch);
+  /* Lock free, for polling consumers */
+  bool empty() const;
+  /* Called by the consumer when the popped batch is written */
+  void done(const RecordBatch& batch);
+  /* Returns when the records pushed before the call are written or
+     dropped */
+  void waitDone();
+  /* Records dropped since the last call, 0 while the queue is not empty */
+  uint64_t takeDropped();
+  void stop();
+
+  QueueStats stats() const;
+
+  /* For the fatal signal handler: visits the queued records, priority
+     ones first, without locking the mutex. Returns false if the lanes are
+     being changed. */
+  template<typename Visit>
+  bool tryVisit(Visit visit) const {
+    std::unique_lock<SignalGuard> guard(m_lanesGuard, std::try_to_lock);
+    if (!guard.owns_lock())
+      return false;
+    for (const auto& record: m_priority) {
+      visit(record);
+    }
+    for (const auto& record: m_records) {
+      visit(record);
+    }
+    return true;
+  }
+
+private:
+  bool take(RecordBatch* batch);
+  void updateSize();
+  bool isPriority(const Record& record) const;
+  bool evictBelow(Level level);
+  void admit(RecordBatch& lane, Record& record);
+  uint64_t pushPriority(Record& record);
+  uint64_t pushBulk(Record& record, std::unique_lock<std::mutex>& lock);
+  /* The smallest sequence number which is not written yet */
+  uint64_t pending() const;
+  bool laneWritten(uint64_t seq) const;
+
+private:
+  const AsyncOptions m_options;
+  Waiter* m_waiter;
+  mutable std::mutex m_mutex;
+  /* Taken after m_mutex whenever the lanes are changed */
+  mutable SignalGuard m_lanesGuard;
+  std::condition_variable m_notFull;
+  std::condition_variable m_done;
+  RecordBatch m_records;
+  RecordBatch m_priority;
+  uint64_t m_nextSeq;
+  /* The first record of the batch being written, 0 if none */
+  uint64_t m_inFlight;
+  uint64_t m_inFlightLast;
+  bool m_inFlightPriority;
+  bool m_stopped;
+  uint64_t m_unreported;
+  QueueStats m_stats;
+  std::atomic<size_t> m_size;
+};
+
+}
+}
@@ -0,0 +1,59 @@
+#include <log/repeat_filter.h>
+
+namespace sl {
+namespace detail {
+
+RepeatFilter::RepeatFilter(Report report) : 
+  m_report(std::move(report)),
+  m_hash(0),
+  m_level(Level::debug),
+  m_repeats(0) {}
+
+RepeatFilter::~RepeatFilter() {
+  try {
+    flush();
+  } catch (...) {
+  }
+}
+
+bool RepeatFilter::pass(uint64_t hash, Level level, uint64_t& repeats, Level& repeatsLevel) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (hash == m_hash && level == m_level) {
+    ++m_repeats;
+    return false;
+  }
+
+  repeats = m_repeats;
+  repeatsLevel = m_level;
+  m_hash = hash;
+  m_level = level;
+  m_repeats = 0;
+  return true;
+}
+
+uint64_t RepeatFilter::take(Level& level) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto result = m_repeats;
+  level = m_level;
+  m_repeats = 0;
+  return result;
+}
+
+void RepeatFilter::flush() {
+  Level level;
+  auto repeats = take(level);
+  if (repeats != 0 && m_report)
+    m_report(level, repeats);
+}
+
+uint64_t RepeatFilter::hash(const char* data, size_t size) {
+  uint64_t result = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    result ^= (unsigned char)data[i];
+    result *= 1099511628211ull;
+  }
+  return result == 0 ? 1 : result;
+}
+
+}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <log/level.h>
+
+namespace sl {
+namespace detail {
+
+/* Drops the records repeating the previous one of a sink. Records are
+   compared by the level and a hash of the message, the header (time,
+   sequence and thread) isn't a part of it. Called by whoever writes the
+   sink files: the producers under the sink mutex or the writer thread. */
+class RepeatFilter {
+public:
+  using Report = std::function<void(Level level, uint64_t repeats)>;
+
+  explicit RepeatFilter(Report report = Report());
+  /* Reports the repeats left, the sink files must outlive the filter */
+  ~RepeatFilter();
+
+  /* Returns false for a repeat. Otherwise repeats is set to the number of
+     repeats of the previous record, to be reported before this one. */
+  bool pass(uint64_t hash, Level level, uint64_t& repeats, Level& repeatsLevel);
+  /* The repeats not reported yet, counting starts over */
+  uint64_t take(Level& level);
+  /* Passes the repeats not reported yet to report */
+  void flush();
+
+  /* FNV-1a, never 0 */
+  static uint64_t hash(const char* data, size_t size);
+
+private:
+  Report m_report;
+  std::mutex m_mutex;
+  uint64_t m_hash;
+  Level m_level;
+  uint64_t m_repeats;
+};
+
+using RepeatFilterPtr = std::unique_ptr<RepeatFilter>;
+
+}
+}
@@ -1,5 +1,7 @@
 #include <stdexcept>
+#include <limits>
 #include <log/rotation_limit_watcher.h>
+#include <log/utils.h>
 
 namespace sl {
 namespace detail {
@@ -7,25 +9,53 @@ namespace detail {
 RotationLimitWatcher::RotationLimitWatcher(
     int64_t totalLimit, 
     int64_t fileLimit,
-    RotationLimitWatcherHandler* watcherHandler) :
+    RotationLimitWatcherHandler* watcherHandler,
+    const RotationOptions& rotation) :
   m_totalLimit(totalLimit),
   m_fileLimit(fileLimit),
   m_size(0),
+  m_written(0),
+  m_fileSize(0),
+  m_rotation(rotation),
+  m_periodStart(kNoPeriod),
+  m_nextBoundary(timeBased() ? 0 : std::numeric_limits<int64_t>::max()),
   m_handler(watcherHandler) {
   if (m_totalLimit < m_fileLimit) {
     throw std::runtime_error("RotationLimitWatcher: totalLimit < fileLimit");
   } 
+  if (timeBased() && 
+      m_rotation.period == RotationPeriod::interval && 
+      m_rotation.interval <= 0) {
+    throw std::runtime_error("RotationLimitWatcher: interval <= 0");
+  }
+}
+
+bool RotationLimitWatcher::timeBased() const {
+  return m_rotation.policy != RotationPolicy::size;
 }
 
 void RotationLimitWatcher::addWritten(int64_t bytesWritten) {
-  int fileCount = m_size / m_fileLimit;
-  int newFileCount = (m_size + bytesWritten) / m_fileLimit;
+  bool rotate;
+  if (m_rotation.policy == RotationPolicy::size) {
+    /* m_size may be adjusted by removals and compression, rotation points
+       are counted from the written bytes */
+    int64_t fileCount = m_written / m_fileLimit;
+    int64_t newFileCount = (m_written + bytesWritten) / m_fileLimit;
+    rotate = newFileCount != fileCount;
+  } else {
+    rotate = m_rotation.policy == RotationPolicy::sizeOrTime &&
+             m_fileSize + bytesWritten >= m_fileLimit;
+  }
 
-  if (newFileCount != fileCount) {
+  if (rotate) {
     m_handler->nextFile();
+    m_fileSize = 0;
+  } else {
+    m_fileSize += bytesWritten;
   }
 
   m_size += bytesWritten;
+  m_written += bytesWritten;
 
   if (m_size >= m_totalLimit) {
     auto clearedSize = m_handler->clearNeeded();
@@ -39,5 +69,53 @@ void RotationLimitWatcher::setSize(int64_t size) {
   m_size = size;
 }
 
+void RotationLimitWatcher::setActiveFile(int64_t size, int64_t lastModified) {
+  m_fileSize = size;
+  m_written = size;
+  /* A non-empty file left from the previous run belongs to the period it was
+     last written in, so it gets rotated by the first record of a later one */
+  if (timeBased() && size > 0)
+    startPeriod(lastModified);
+}
+
+void RotationLimitWatcher::nextPeriod(int64_t timestamp) {
+  if (m_periodStart != kNoPeriod && m_fileSize > 0) {
+    m_handler->nextFile();
+    m_fileSize = 0;
+  }
+  startPeriod(timestamp / 1000000);
+}
+
+void RotationLimitWatcher::startPeriod(int64_t timeSec) {
+  int64_t next;
+
+  switch (m_rotation.period) {
+    case RotationPeriod::interval:
+      m_periodStart = timeSec - timeSec % m_rotation.interval;
+      next = m_periodStart + m_rotation.interval;
+      break;
+    case RotationPeriod::hourly: {
+      struct tm local = ts::localTime(timeSec);
+      m_periodStart = timeSec - local.tm_min * 60 - local.tm_sec;
+      next = m_periodStart + 3600;
+      break;
+    }
+    case RotationPeriod::daily: {
+      struct tm local = ts::localTime(timeSec);
+      local.tm_hour = local.tm_min = local.tm_sec = 0;
+      local.tm_isdst = -1;
+      m_periodStart = mktime(&local);
+      local.tm_mday += 1;
+      local.tm_isdst = -1;
+      next = mktime(&local);
+      break;
+    }
+    default:
+      throw std::runtime_error("RotationLimitWatcher: unknown period");
+  }
+
+  m_nextBoundary = next * 1000000;
+}
+
 }
 }
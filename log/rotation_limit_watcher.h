@@ -2,24 +2,48 @@
 
 #include <cstdint>
 #include <log/rotation_limit_watcher_handler.h>
+#include <log/sink_options.h>
 
 namespace sl {
 namespace detail {
 
 class RotationLimitWatcher {
+  static const int64_t kNoPeriod = -1;
 public:
   RotationLimitWatcher(
     int64_t totalLimit, 
     int64_t fileLimit,
-    RotationLimitWatcherHandler* watcherHandler);
+    RotationLimitWatcherHandler* watcherHandler,
+    const RotationOptions& rotation = RotationOptions());
+
+  /* Called with the record time (microseconds since epoch) before the record
+     is written. Rotates the active file if the current period is over. */
+  void checkTime(int64_t timestamp) {
+    if (timestamp >= m_nextBoundary)
+      nextPeriod(timestamp);
+  }
 
   void addWritten(int64_t bytesWritten);
   void setSize(int64_t);
+  void setActiveFile(int64_t size, int64_t lastModified);
+
+  /* Start of the current period, seconds since epoch */
+  int64_t periodStart() const { return m_periodStart; }
+
+private:
+  bool timeBased() const;
+  void nextPeriod(int64_t timestamp);
+  void startPeriod(int64_t timeSec);
 
 private:
   int64_t m_totalLimit;
   int64_t m_fileLimit;
   int64_t m_size;
+  int64_t m_written;
+  int64_t m_fileSize;
+  RotationOptions m_rotation;
+  int64_t m_periodStart;
+  int64_t m_nextBoundary;
   RotationLimitWatcherHandler* m_handler;
 };
 
@@ -0,0 +1,22 @@
+#include <log/sharded_counter.h>
+
+namespace sl {
+namespace detail {
+
+uint64_t ShardedCounter::value() const {
+  uint64_t result = 0;
+  for (const auto& shard: m_shards) {
+    result += shard.value.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+/* Threads are spread round robin in the order of their first addition */
+size_t ShardedCounter::shard() {
+  static std::atomic<size_t> next(0);
+  thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return index;
+}
+
+}
+}
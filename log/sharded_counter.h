@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+namespace sl {
+namespace detail {
+
+/* Relaxed counter split into cache line sized shards, each thread adds to
+   its own one so that concurrent producers don't share a line. Reads sum
+   the shards and may miss the additions in flight. */
+class ShardedCounter {
+public:
+  static const size_t kShards = 16;
+
+  ShardedCounter() {}
+  ShardedCounter(const ShardedCounter&) = delete;
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  void add(uint64_t value = 1) {
+    m_shards[shard()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const;
+
+private:
+  static size_t shard();
+
+private:
+  /* Padded rather than alignas(64): the counter is heap allocated and new
+     does not honour extended alignment before C++17. The values are a line
+     apart whatever the start address is. */
+  struct Shard {
+    std::atomic<uint64_t> value;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+
+    Shard() : value(0) {}
+  };
+
+  Shard m_shards[kShards];
+};
+
+}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+
+namespace sl {
+namespace detail {
+
+/* Held, besides the mutex, while the containers read by the fatal signal
+   handler are changed. try_lock never waits and is async-signal-safe, lock
+   spins only while the handler reads. Lockable, for std::lock_guard. */
+class SignalGuard {
+public:
+  SignalGuard() { m_flag.clear(); }
+  SignalGuard(const SignalGuard&) = delete;
+  SignalGuard& operator=(const SignalGuard&) = delete;
+
+  void lock() {
+    while (m_flag.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+
+  bool try_lock() { return !m_flag.test_and_set(std::memory_order_acquire); }
+  void unlock() { m_flag.clear(std::memory_order_release); }
+
+private:
+  std::atomic_flag m_flag;
+};
+
+}
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <functional>
+#include <vector>
+#include <log/level.h>
+
+namespace sl {
+
+enum class RotationPolicy {
+  size,      /* rotate when fileLimit is reached */
+  time,      /* rotate on period boundaries only */
+  sizeOrTime /* whichever comes first */
+};
+
+enum class RotationPeriod {
+  interval, /* fixed intervals of RotationOptions::interval seconds */
+  hourly,   /* local wall-clock hours */
+  daily     /* local midnight */
+};
+
+struct RotationOptions {
+  RotationPolicy policy;
+  RotationPeriod period;
+  int64_t interval;
+
+  RotationOptions() : policy(RotationPolicy::size),
+                      period(RotationPeriod::daily),
+                      interval(0) {}
+
+  RotationOptions(RotationPolicy policy,
+                  RotationPeriod period,
+                  int64_t interval = 0) :
+    policy(policy),
+    period(period),
+    interval(interval) {}
+};
+
+enum class IoClass {
+  none, /* inherited */
+  realtime,
+  bestEffort,
+  idle
+};
+
+/* Placement and priority of a background thread, applied by the thread
+   itself on start (Linux only, failures are ignored) */
+struct ThreadOptions {
+  std::vector<int> cpus; /* affinity, empty - any CPU */
+  int nice;              /* SCHED_OTHER nice level, 0 - inherited */
+  IoClass ioClass;       /* ioprio_set class */
+  int ioLevel;           /* 0 (highest) - 7, for realtime and bestEffort */
+
+  ThreadOptions(int nice = 0) : 
+    nice(nice),
+    ioClass(IoClass::none),
+    ioLevel(4) {}
+};
+
+enum class Compression {
+  none,
+  lz /* rotated files are turned into seekable archives in the background */
+};
+
+/* Enforced in the background on top of the totalLimit */
+struct RetentionOptions {
+  int64_t maxAge;  /* seconds, 0 - unlimited */
+  size_t maxFiles; /* including the active one, 0 - unlimited */
+
+  RetentionOptions() : maxAge(0), maxFiles(0) {}
+
+  RetentionOptions(int64_t maxAge, size_t maxFiles = 0) :
+    maxAge(maxAge),
+    maxFiles(maxFiles) {}
+};
+
+enum class Durability {
+  none,     /* syncing is left to the OS */
+  periodic, /* fdatasync every DurabilityOptions::interval ms in the background */
+  onError   /* fdatasync before returning from logging a record of
+               DurabilityOptions::level or above */
+};
+
+struct DurabilityOptions {
+  Durability mode;
+  int64_t interval; /* milliseconds */
+  Level level;
+
+  DurabilityOptions() : mode(Durability::none),
+                        interval(1000),
+                        level(Level::error) {}
+
+  DurabilityOptions(Durability mode, 
+                    int64_t interval = 1000, 
+                    Level level = Level::error) :
+    mode(mode),
+    interval(interval),
+    level(level) {}
+};
+
+/* Reported when a sink fails to write and when it has recovered */
+struct SinkError {
+  std::string baseName;
+  std::string message;
+  int code; /* errno, 0 if unknown */
+  bool recovered;
+};
+
+using SinkErrorHandler = std::function<void(const SinkError&)>;
+
+/* While the sink is failing records are spilled to spillDir, if set, or
+   dropped. The sink is reopened in the background with the retry interval
+   doubling from retryInterval to maxRetryInterval ms. */
+struct ErrorOptions {
+  int64_t retryInterval;
+  int64_t maxRetryInterval;
+  std::string spillDir;
+  int64_t spillLimit; /* bytes, 0 - unlimited */
+  /* Called from a background thread */
+  SinkErrorHandler handler;
+
+  ErrorOptions() : retryInterval(100),
+                   maxRetryInterval(10000),
+                   spillLimit(0) {}
+};
+
+struct SinkErrorStats {
+  uint64_t errors;
+  uint64_t dropped;
+  uint64_t spilled;
+  bool degraded;
+
+  SinkErrorStats() : errors(0), dropped(0), spilled(0), degraded(false) {}
+};
+
+/* What a producer does when the sink queue is full */
+enum class OverflowPolicy {
+  block,         /* waits up to AsyncOptions::blockTimeout ms, then drops */
+  dropNewest,
+  dropOldest,
+  dropBelowLevel /* drops records below AsyncOptions::keepLevel, the others
+                    take the place of the oldest queued record below it */
+};
+
+/* How the writer thread waits for records */
+enum class WaitStrategy {
+  spin,      /* busy polling, the lowest latency for an isolated core */
+  spinYield, /* polling, yielding the CPU between the checks after a while */
+  park       /* spins briefly, then sleeps; producers wake it only when it
+                actually sleeps */
+};
+
+/* Records are formatted by the caller and written by a per sink thread.
+   With a non zero priorityQueueSize records of priorityLevel and above go
+   to a separate lane which is written first (or to the main queue if the
+   lane is full), and each record gets a "#<sequence>" field after the
+   level so the total order can be restored. */
+struct AsyncOptions {
+  size_t queueSize; /* records, 0 - synchronous logging */
+  OverflowPolicy overflow;
+  int64_t blockTimeout; /* ms, -1 - forever */
+  Level keepLevel;
+  size_t priorityQueueSize;
+  Level priorityLevel;
+  /* The producer of a priority record waits until it is written */
+  bool priorityFlush;
+  /* Each producer thread gets its own wait-free queue of queueSize records
+     which the writer merges by timestamp. There is no priority lane, full
+     queues block with the timeout or, with the other policies, drop the
+     newest record. */
+  bool perThread;
+  WaitStrategy waitStrategy;
+
+  AsyncOptions() : queueSize(0),
+                   overflow(OverflowPolicy::block),
+                   blockTimeout(100),
+                   keepLevel(Level::warning),
+                   priorityQueueSize(0),
+                   priorityLevel(Level::error),
+                   priorityFlush(false),
+                   perThread(false),
+                   waitStrategy(WaitStrategy::park) {}
+
+  AsyncOptions(size_t queueSize, 
+               OverflowPolicy overflow = OverflowPolicy::block,
+               int64_t blockTimeout = 100) :
+    queueSize(queueSize),
+    overflow(overflow),
+    blockTimeout(blockTimeout),
+    keepLevel(Level::warning),
+    priorityQueueSize(0),
+    priorityLevel(Level::error),
+    priorityFlush(false),
+    perThread(false),
+    waitStrategy(WaitStrategy::park) {}
+};
+
+struct QueueStats {
+  uint64_t queued;
+  uint64_t written;
+  uint64_t dropped;
+  uint64_t blocked; /* producers which had to wait */
+  size_t maxDepth;
+
+  QueueStats() : queued(0), written(0), dropped(0), blocked(0), maxDepth(0) {}
+};
+
+/* Runtime counters of a sink, times are in nanoseconds */
+struct SinkStats {
+  uint64_t written;   /* records written to the files, drop notices included */
+  uint64_t filtered;  /* records below the level, as checked by isEnabled */
+  uint64_t dropped;   /* by the full queue or while the sink was failing */
+  uint64_t bytes;
+  uint64_t rotations;
+  uint64_t deletions; /* files removed by the limits and the retention */
+  uint64_t writeErrors;
+  int64_t writeTime;  /* in FileStream::write */
+  int64_t rotationTime;
+  size_t maxQueueDepth;
+
+  SinkStats() : written(0), filtered(0), dropped(0), bytes(0), rotations(0),
+                deletions(0), writeErrors(0), writeTime(0), rotationTime(0),
+                maxQueueDepth(0) {}
+};
+
+/* Records below the sink level but at or above level are kept in a ring of
+   the last size records, which is written to the sink before the next
+   record of trigger level or above (or by Logger::dumpBacktrace). The
+   message is formatted on capture, the time and level header on dump. */
+struct BacktraceOptions {
+  size_t size; /* records, 0 - no backtrace */
+  Level level;
+  Level trigger;
+
+  BacktraceOptions(size_t size = 0, 
+                   Level level = Level::debug, 
+                   Level trigger = Level::error) :
+    size(size),
+    level(level),
+    trigger(trigger) {}
+};
+
+/* Records of level and above (including the ones below the sink level) are
+   also copied to a memory mapped ring of size bytes, <logDir>/.<base>.flight
+   unless fileName is set (it must not match <logDir>/<base>*, those files
+   are rotated). The last records survive a crash of the process and are
+   extracted by FlightRecorder::recover or tools/sl_recover. */
+struct FlightRecorderOptions {
+  int64_t size; /* bytes, 0 - no recorder */
+  Level level;
+  std::string fileName;
+
+  FlightRecorderOptions(int64_t size = 0, Level level = Level::debug) :
+    size(size),
+    level(level) {}
+};
+
+struct SinkOptions {
+  int64_t totalLimit;
+  int64_t fileLimit;
+  bool duplicateToStdout;
+  RotationOptions rotation;
+  RetentionOptions retention;
+  Compression compression;
+  size_t compressionThreads; /* 0 - one per core */
+  /* Write-back smoothing: non zero chunk size makes written data go to the
+     disk chunk by chunk and leave the page cache afterwards */
+  int64_t writeBackChunk;
+  DurabilityOptions durability;
+  ErrorOptions errors;
+  AsyncOptions async;
+  BacktraceOptions backtrace;
+  FlightRecorderOptions flightRecorder;
+  /* The asynchronous sink writer */
+  ThreadOptions writerThread;
+  /* Compression, including the compressionThreads pool */
+  ThreadOptions compressorThread;
+  /* Retention, periodic syncs and error recovery */
+  ThreadOptions housekeeperThread;
+  /* ms, non zero makes the sink write its SinkStats as an info record with
+     this interval (from a thread run with housekeeperThread options) */
+  int64_t statsInterval;
+  /* Records the time spent in each stage, see Logger::latencyStats. Costs
+     a few clock reads per record. */
+  bool latencyHistograms;
+  /* Consecutive records with the same level and message are written once,
+     "last message repeated N times" follows when a different record comes,
+     on Logger::flush or when the sink is destroyed */
+  bool suppressRepeats;
+
+  SinkOptions(int64_t totalLimit,
+              int64_t fileLimit,
+              bool duplicateToStdout = false) :
+    totalLimit(totalLimit),
+    fileLimit(fileLimit),
+    duplicateToStdout(duplicateToStdout),
+    compression(Compression::none),
+    compressionThreads(1),
+    writeBackChunk(0),
+    compressorThread(19),
+    statsInterval(0),
+    latencyHistograms(false),
+    suppressRepeats(false) {}
+};
+
+}
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <log/staging_buffers.h>
+#include <log/utils.h>
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+size_t roundUpToPowerOf2(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+/* Rings of the current thread by the owner id. Ids are never reused,
+   unlike addresses. */
+struct ThreadRings {
+  struct Entry {
+    uint64_t owner;
+    SpscRingPtr ring;
+  };
+
+  std::vector<Entry> entries;
+
+  ~ThreadRings() {
+    for (auto& entry: entries) {
+      entry.ring->closed = true;
+    }
+  }
+};
+
+thread_local ThreadRings t_rings;
+std::atomic<uint64_t> g_nextId(1);
+
+}
+
+SpscRing::SpscRing(size_t capacity)
+  : closed(false),
+    orphaned(false),
+    dropped(0),
+    blocked(0),
+    m_slots(roundUpToPowerOf2(std::max<size_t>(capacity, 1))),
+    m_mask(m_slots.size() - 1),
+    m_head(0),
+    m_tail(0),
+    m_headCache(0)
+{
+}
+
+bool SpscRing::push(Record& record) {
+  auto tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_headCache >= m_slots.size()) {
+    m_headCache = m_head.load(std::memory_order_acquire);
+    if (tail - m_headCache >= m_slots.size())
+      return false;
+  }
+
+  m_slots[tail & m_mask] = std::move(record);
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+Record* SpscRing::front() {
+  auto head = m_head.load(std::memory_order_relaxed);
+  if (head == m_tail.load(std::memory_order_acquire))
+    return nullptr;
+
+  return &m_slots[head & m_mask];
+}
+
+void SpscRing::pop() {
+  auto head = m_head.load(std::memory_order_relaxed);
+  /* the memory is freed here rather than by the producer on the next push */
+  std::string().swap(m_slots[head & m_mask].data);
+  m_head.store(head + 1, std::memory_order_release);
+}
+
+StagingBuffers::StagingBuffers(const AsyncOptions& options)
+  : m_options(options),
+    m_id(g_nextId++),
+    m_stopped(false),
+    m_written(0),
+    m_reported(0),
+    m_maxDepth(0)
+{
+}
+
+StagingBuffers::~StagingBuffers() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& ring: m_rings) {
+    ring->orphaned = true;
+  }
+}
+
+SpscRing* StagingBuffers::threadRing() {
+  auto& entries = t_rings.entries;
+  for (auto& entry: entries) {
+    if (entry.owner == m_id)
+      return entry.ring.get();
+  }
+
+  entries.erase(std::remove_if(entries.begin(), entries.end(), 
+                               [](const ThreadRings::Entry& entry) { 
+                                 return (bool)entry.ring->orphaned; 
+                               }),
+                entries.end());
+
+  auto ring = std::make_shared<SpscRing>(m_options.queueSize);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<SignalGuard> guard(m_ringsGuard);
+    m_rings.push_back(ring);
+  }
+  entries.push_back({m_id, ring});
+
+  return ring.get();
+}
+
+bool StagingBuffers::push(Record record) {
+  auto ring = threadRing();
+  if (ring->push(record))
+    return true;
+
+  if (m_options.overflow == OverflowPolicy::block && m_options.blockTimeout != 0) {
+    auto deadline = std::chrono::steady_clock::now() + 
+                    std::chrono::milliseconds(m_options.blockTimeout);
+    ++ring->blocked;
+    while (!m_stopped && 
+           (m_options.blockTimeout < 0 || std::chrono::steady_clock::now() < deadline)) {
+      std::this_thread::yield();
+      if (ring->push(record))
+        return true;
+    }
+  }
+
+  ring->dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+size_t StagingBuffers::drain(const std::function<void(const Record&)>& write) {
+  struct Cursor {
+    SpscRing* ring;
+    uint64_t end;
+  };
+
+  std::vector<SpscRingPtr> rings;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    rings = m_rings;
+  }
+
+  /* Only the records which are there now, a busy producer can't keep the
+     others waiting */
+  std::vector<Cursor> cursors;
+  size_t depth = 0;
+  for (auto& ring: rings) {
+    auto end = ring->pushed();
+    auto begin = ring->popped();
+    if (begin != end) {
+      cursors.push_back({ring.get(), end});
+      depth += end - begin;
+    }
+  }
+
+  /* Measured records are stamped once per drain, the time spent writing
+     the ones merged before them isn't queueing */
+  int64_t takenAt = 0;
+
+  auto later = [](const Cursor& a, const Cursor& b) { 
+    return a.ring->front()->timestamp > b.ring->front()->timestamp; 
+  };
+
+  size_t written = 0;
+  std::make_heap(cursors.begin(), cursors.end(), later);
+  while (!cursors.empty()) {
+    std::pop_heap(cursors.begin(), cursors.end(), later);
+    auto& cursor = cursors.back();
+    auto record = cursor.ring->front();
+    if (record->queuedAt != 0) {
+      if (takenAt == 0)
+        takenAt = ts::steadyNs();
+      record->takenAt = takenAt;
+    }
+    write(*record);
+    {
+      /* pop frees the record, the signal handler may be visiting it */
+      std::lock_guard<SignalGuard> guard(m_ringsGuard);
+      cursor.ring->pop();
+    }
+    ++written;
+
+    if (cursor.ring->popped() < cursor.end) {
+      std::push_heap(cursors.begin(), cursors.end(), later);
+    } else {
+      cursors.pop_back();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_written += written;
+  m_maxDepth = std::max(m_maxDepth, depth);
+
+  /* closed is checked first, nothing can be pushed after it is set */
+  {
+    std::lock_guard<SignalGuard> guard(m_ringsGuard);
+    m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), 
+                                 [this](const SpscRingPtr& ring) {
+                                   if (!ring->closed || ring->pushed() != ring->popped())
+                                     return false;
+                                   m_retired.queued += ring->pushed();
+                                   m_retired.dropped += ring->dropped;
+                                   m_retired.blocked += ring->blocked;
+                                   return true;
+                                 }),
+                  m_rings.end());
+  }
+
+  if (written != 0)
+    m_done.notify_all();
+
+  return written;
+}
+
+bool StagingBuffers::pending() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return std::any_of(m_rings.begin(), m_rings.end(), [](const SpscRingPtr& ring) {
+    return ring->pushed() != ring->popped();
+  });
+}
+
+uint64_t StagingBuffers::takeDropped() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint64_t dropped = m_retired.dropped;
+  for (auto& ring: m_rings) {
+    if (ring->pushed() != ring->popped())
+      return 0;
+    dropped += ring->dropped;
+  }
+
+  auto result = dropped - m_reported;
+  m_reported = dropped;
+  return result;
+}
+
+void StagingBuffers::waitDone() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::vector<std::pair<SpscRingPtr, uint64_t>> targets;
+  for (auto& ring: m_rings) {
+    targets.emplace_back(ring, ring->pushed());
+  }
+
+  m_done.wait(lock, [this, &targets] {
+    return m_stopped || 
+           std::all_of(targets.begin(), targets.end(), 
+                       [](const std::pair<SpscRingPtr, uint64_t>& target) {
+                         return target.first->popped() >= target.second;
+                       });
+  });
+}
+
+void StagingBuffers::stop() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stopped = true;
+  m_done.notify_all();
+}
+
+size_t StagingBuffers::threads() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_rings.size();
+}
+
+QueueStats StagingBuffers::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  QueueStats result = m_retired;
+  for (auto& ring: m_rings) {
+    result.queued += ring->pushed();
+    result.dropped += ring->dropped;
+    result.blocked += ring->blocked;
+  }
+  result.written = m_written;
+  result.maxDepth = m_maxDepth;
+
+  return result;
+}
+
+}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <log/record_queue.h>
+#include <log/signal_guard.h>
+
+namespace sl {
+namespace detail {
+
+/* Wait-free single producer single consumer ring of records */
+class SpscRing {
+public:
+  /* capacity is rounded up to a power of two */
+  explicit SpscRing(size_t capacity);
+
+  /* Producer side. The record is moved from only on success. */
+  bool push(Record& record);
+
+  /* Consumer side, front() is nullptr if the ring is empty */
+  Record* front();
+  void pop();
+
+  uint64_t pushed() const { return m_tail.load(std::memory_order_acquire); }
+  uint64_t popped() const { return m_head.load(std::memory_order_acquire); }
+
+  /* Consumer side, visits the records in the ring without popping them */
+  template<typename Visit>
+  void visit(Visit visit) const {
+    auto tail = m_tail.load(std::memory_order_acquire);
+    for (auto i = m_head.load(std::memory_order_acquire); i != tail; ++i) {
+      visit(m_slots[i & m_mask]);
+    }
+  }
+
+  /* Set by the producer thread on exit */
+  std::atomic<bool> closed;
+  /* Set when the owner is gone, the producer forgets the ring then */
+  std::atomic<bool> orphaned;
+  /* Producer side counters */
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> blocked;
+
+private:
+  std::vector<Record> m_slots;
+  size_t m_mask;
+  alignas(64) std::atomic<uint64_t> m_head;
+  alignas(64) std::atomic<uint64_t> m_tail;
+  /* Producer's copy of m_head, refreshed when the ring looks full */
+  uint64_t m_headCache;
+};
+
+using SpscRingPtr = std::shared_ptr<SpscRing>;
+
+/* Per producer thread rings, registered on the first push from a thread
+   and freed by the consumer once the thread has exited and its ring is
+   drained. */
+class StagingBuffers {
+public:
+  StagingBuffers(const AsyncOptions& options);
+  ~StagingBuffers();
+
+  bool push(Record record);
+
+  /* Consumer side. Writes the records which are in the rings at the call,
+     merged by timestamp. Returns the number of records written. */
+  size_t drain(const std::function<void(const Record&)>& write);
+  bool pending() const;
+  /* Dropped since the last call, 0 while records are pending */
+  uint64_t takeDropped();
+
+  /* Returns when the records pushed before the call are written */
+  void waitDone();
+  void stop();
+
+  QueueStats stats() const;
+  /* Registered producer threads */
+  size_t threads() const;
+
+  /* For the fatal signal handler: visits the staged records thread by
+     thread without locking the mutex. Returns false if the list of the
+     rings is being changed or a record is being popped. */
+  template<typename Visit>
+  bool tryVisit(Visit visit) const {
+    std::unique_lock<SignalGuard> guard(m_ringsGuard, std::try_to_lock);
+    if (!guard.owns_lock())
+      return false;
+    for (const auto& ring: m_rings) {
+      ring->visit(visit);
+    }
+    return true;
+  }
+
+private:
+  SpscRing* threadRing();
+
+private:
+  const AsyncOptions m_options;
+  const uint64_t m_id;
+  mutable std::mutex m_mutex;
+  /* Taken after m_mutex whenever m_rings is changed and by the writer
+     around popping a record */
+  mutable SignalGuard m_ringsGuard;
+  std::condition_variable m_done;
+  std::vector<SpscRingPtr> m_rings;
+  std::atomic<bool> m_stopped;
+  /* Totals of the rings which have been freed */
+  QueueStats m_retired;
+  uint64_t m_written;
+  uint64_t m_reported;
+  size_t m_maxDepth;
+};
+
+}
+}
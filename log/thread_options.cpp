@@ -0,0 +1,64 @@
+#include <log/thread_options.h>
+
+#if defined (__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace sl {
+namespace detail {
+
+#if defined (__linux__)
+
+namespace {
+
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassShift = 13;
+
+int ioprioClass(IoClass ioClass) {
+  switch (ioClass) {
+    case IoClass::realtime:   return 1;
+    case IoClass::bestEffort: return 2;
+    case IoClass::idle:       return 3;
+    default:                  return 0;
+  }
+}
+
+}
+
+void applyThreadOptions(const ThreadOptions& options) {
+  auto tid = (id_t)syscall(SYS_gettid);
+
+  if (!options.cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (auto cpu: options.cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &cpus);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+
+  /* nice is per thread on Linux */
+  if (options.nice != 0)
+    setpriority(PRIO_PROCESS, tid, options.nice);
+
+  if (options.ioClass != IoClass::none) {
+    int level = options.ioClass == IoClass::idle ? 0 : options.ioLevel;
+    syscall(SYS_ioprio_set, kIoprioWhoProcess, (int)tid, 
+            (ioprioClass(options.ioClass) << kIoprioClassShift) | level);
+  }
+}
+
+#else
+
+void applyThreadOptions(const ThreadOptions& /*options*/) {
+}
+
+#endif
+
+}
+}
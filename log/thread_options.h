@@ -0,0 +1,12 @@
+#pragma once
+
+#include <log/sink_options.h>
+
+namespace sl {
+namespace detail {
+
+/* Applies options to the calling thread */
+void applyThreadOptions(const ThreadOptions& options);
+
+}
+}
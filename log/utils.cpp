@@ -1,12 +1,47 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <chrono>
 #include <string.h>
 #include <stdlib.h>
 #include <log/utils.h>
 #include <log/exception.h>
 #include <log/format.h>
 
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#include <sys/time.h>
+#elif defined (_WIN32)
+
+// this function is taken somewhere from stackoverflow
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <stdint.h> 
+
+typedef struct timeval {
+	long tv_sec;
+	long tv_usec;
+} timeval;
+
+int gettimeofday(struct timeval * tp, struct timezone * tzp)
+{
+	static const uint64_t EPOCH = ((uint64_t)116444736000000000ULL);
+
+	SYSTEMTIME  system_time;
+	FILETIME    file_time;
+	uint64_t    time;
+
+	GetSystemTime(&system_time);
+	SystemTimeToFileTime(&system_time, &file_time);
+	time = ((uint64_t)file_time.dwLowDateTime);
+	time += ((uint64_t)file_time.dwHighDateTime) << 32;
+
+	tp->tv_sec = (long)((time - EPOCH) / 10000000L);
+	tp->tv_usec = (long)(system_time.wMilliseconds * 1000);
+	return 0;
+}
+
+#endif
+
 namespace sl {
 namespace detail {
 
@@ -236,6 +271,48 @@ std::string Dir::name() const { return m_impl->name(); }
 
 }
 
+namespace str {
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), std::string::npos, suffix) == 0;
+}
+
+}
+
+namespace ts {
+
+int64_t now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+int64_t steadyNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct tm localTime(int64_t timeSec) {
+  time_t t = (time_t)timeSec;
+  struct tm result;
+#if defined (_WIN32)
+  localtime_s(&result, &t);
+#else
+  localtime_r(&t, &result);
+#endif
+  return result;
+}
+
+std::string format(int64_t timeSec, const char* formatStr) {
+  char buf[64];
+  struct tm local = localTime(timeSec);
+  size_t len = strftime(buf, sizeof(buf), formatStr, &local);
+  return std::string(buf, len);
+}
+
+}
+
 }
 }
 
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <functional>
 #include <memory>
+#include <cstdint>
+#include <ctime>
 
 #if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
 # include <dirent.h>
@@ -54,6 +56,20 @@ private:
 };
 }
 
+namespace ts {
+/* Current wall-clock time, microseconds since epoch */
+int64_t now();
+
+/* Monotonic clock for measuring intervals, nanoseconds */
+int64_t steadyNs();
+
+/* Thread safe localtime() */
+struct tm localTime(int64_t timeSec);
+
+/* strftime() of the local time */
+std::string format(int64_t timeSec, const char* formatStr);
+}
+
 namespace str {
 
 namespace detail {
@@ -155,6 +171,8 @@ void fillResult(std::string& result,
 
 }
 
+bool endsWith(const std::string& s, const std::string& suffix);
+
 template<typename... Args>
 std::string join(const Args&... args) {
   std::string result;
@@ -0,0 +1,99 @@
+#include <thread>
+#include <chrono>
+#include <log/waiter.h>
+
+#if defined (_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace sl {
+namespace detail {
+
+namespace {
+
+const int kSpinIterations = 1000;
+const int kYieldIterations = 100;
+const std::chrono::milliseconds kParkTimeout(100);
+
+inline void cpuRelax() {
+#if defined (_MSC_VER)
+  _mm_pause();
+#elif defined (__x86_64__) || defined (__i386__)
+  __builtin_ia32_pause();
+#elif defined (__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+}
+
+Waiter::Waiter(WaitStrategy strategy)
+  : m_strategy(strategy),
+    m_sleeping(false),
+    m_wakeups(0)
+{
+}
+
+bool Waiter::spin(const Ready& ready, int iterations) {
+  for (int i = 0; i < iterations; ++i) {
+    if (ready())
+      return true;
+    cpuRelax();
+  }
+
+  return false;
+}
+
+bool Waiter::yield(const Ready& ready, int iterations) {
+  for (int i = 0; i < iterations; ++i) {
+    if (ready())
+      return true;
+    std::this_thread::yield();
+  }
+
+  return false;
+}
+
+void Waiter::wait(const Ready& ready) {
+  switch (m_strategy) {
+    case WaitStrategy::spin:
+      while (!spin(ready, kSpinIterations)) {}
+      break;
+    case WaitStrategy::spinYield:
+      if (!spin(ready, kSpinIterations)) {
+        while (!yield(ready, kYieldIterations)) {}
+      }
+      break;
+    case WaitStrategy::park:
+      if (!spin(ready, kSpinIterations) && !yield(ready, kYieldIterations))
+        park(ready);
+      break;
+  }
+}
+
+/* The flag is raised before the last check and producers read it after
+   publishing, the fences make sure one of the sides sees the other */
+void Waiter::park(const Ready& ready) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_sleeping.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  while (!ready()) {
+    m_cond.wait_for(lock, kParkTimeout);
+    ++m_wakeups;
+  }
+
+  m_sleeping.store(false, std::memory_order_relaxed);
+}
+
+void Waiter::notify() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!m_sleeping.load(std::memory_order_relaxed))
+    return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cond.notify_one();
+}
+
+}
+}
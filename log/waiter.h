@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <log/sink_options.h>
+
+namespace sl {
+namespace detail {
+
+/* Consumer side wait following a WaitStrategy. Producers call notify()
+   after publishing, which costs a fence and a load unless the consumer is
+   parked. */
+class Waiter {
+public:
+  using Ready = std::function<bool()>;
+
+  explicit Waiter(WaitStrategy strategy);
+
+  /* Returns when ready() is true. Parking is bounded by a timeout, so
+     ready() is rechecked periodically even without notifications. */
+  void wait(const Ready& ready);
+  void notify();
+
+  /* Times the consumer has been woken up from parking */
+  uint64_t wakeups() const { return m_wakeups; }
+
+private:
+  bool spin(const Ready& ready, int iterations);
+  bool yield(const Ready& ready, int iterations);
+  void park(const Ready& ready);
+
+private:
+  const WaitStrategy m_strategy;
+  std::atomic<bool> m_sleeping;
+  std::atomic<uint64_t> m_wakeups;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+}
+}
@@ -0,0 +1,80 @@
+#include <log/worker.h>
+#include <log/thread_options.h>
+
+namespace sl {
+namespace detail {
+
+Worker::Worker(const ThreadOptions& options) 
+  : m_stopped(false),
+    m_options(options),
+    m_thread([this] { run(); }) 
+{
+}
+
+Worker::~Worker() {
+  stop();
+}
+
+void Worker::post(Task task) {
+  post(std::move(task), std::chrono::milliseconds(0));
+}
+
+void Worker::post(Task task, std::chrono::milliseconds delay) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_stopped)
+    return;
+
+  m_tasks.emplace(Clock::now() + delay, std::move(task));
+  m_cond.notify_one();
+}
+
+void Worker::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    m_cond.notify_one();
+  }
+
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+size_t Worker::pending() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tasks.size();
+}
+
+void Worker::run() {
+  applyThreadOptions(m_options);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    auto now = Clock::now();
+    if (!m_tasks.empty() && m_tasks.begin()->first <= now) {
+      auto task = std::move(m_tasks.begin()->second);
+      m_tasks.erase(m_tasks.begin());
+      lock.unlock();
+      try {
+        task();
+      } catch (...) {
+      }
+      lock.lock();
+      continue;
+    }
+
+    if (m_stopped) {
+      m_tasks.clear();
+      return;
+    }
+
+    if (m_tasks.empty()) {
+      m_cond.wait(lock);
+    } else {
+      m_cond.wait_until(lock, m_tasks.begin()->first);
+    }
+  }
+}
+
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <log/sink_options.h>
+
+namespace sl {
+namespace detail {
+
+/* Background thread running posted tasks in order of their due time.
+   Tasks posted for the same time run in FIFO order. Exceptions thrown by
+   tasks are swallowed. */
+class Worker {
+public:
+  using Task = std::function<void()>;
+  using Clock = std::chrono::steady_clock;
+
+  /* options are applied by the worker thread on start */
+  explicit Worker(const ThreadOptions& options = ThreadOptions());
+  ~Worker();
+
+  void post(Task task);
+  void post(Task task, std::chrono::milliseconds delay);
+
+  /* Runs tasks which are already due, drops the delayed ones and joins */
+  void stop();
+
+  /* Tasks posted and not started yet */
+  size_t pending() const;
+
+private:
+  void run();
+
+private:
+  std::multimap<Clock::time_point, Task> m_tasks;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_stopped;
+  ThreadOptions m_options;
+  std::thread m_thread;
+};
+
+using WorkerPtr = std::unique_ptr<Worker>;
+
+}
+}
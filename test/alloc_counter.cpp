@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <new>
+#include "alloc_counter.h"
+
+namespace {
+
+thread_local bool t_counting = false;
+thread_local uint64_t t_allocations = 0;
+thread_local uint64_t t_deallocations = 0;
+
+void* allocate(size_t size) {
+  if (t_counting)
+    ++t_allocations;
+  if (void* p = malloc(size == 0 ? 1 : size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void deallocate(void* p) {
+  if (p == nullptr)
+    return;
+  if (t_counting)
+    ++t_deallocations;
+  free(p);
+}
+
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+
+namespace alloc {
+
+Scope::Scope() : 
+  m_allocations(t_allocations),
+  m_deallocations(t_deallocations),
+  m_wasCounting(t_counting) {
+  t_counting = true;
+}
+
+Scope::~Scope() {
+  t_counting = m_wasCounting;
+}
+
+uint64_t Scope::allocations() const {
+  return t_allocations - m_allocations;
+}
+
+uint64_t Scope::deallocations() const {
+  return t_deallocations - m_deallocations;
+}
+
+}
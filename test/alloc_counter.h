@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+/* The test binary replaces the global operator new and delete, the
+   allocations made by each thread are counted while a Scope is alive on
+   it */
+namespace alloc {
+
+class Scope {
+public:
+  Scope();
+  ~Scope();
+
+  uint64_t allocations() const;
+  uint64_t deallocations() const;
+
+private:
+  uint64_t m_allocations;
+  uint64_t m_deallocations;
+  bool m_wasCounting;
+};
+
+}
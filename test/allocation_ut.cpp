@@ -0,0 +1,103 @@
+#include "catch.hh"
+#include "file_utils.h"
+#include "alloc_counter.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include <log/log.h>
+
+namespace {
+
+const int kWarmUp = 1000;
+const int kRecords = 1000;
+/* The stream buffer, the copy returned by detail::fmt and the one handed
+   to the sink. Lower it when the formatting path gets cheaper. */
+const double kFormatAllocations = 3;
+
+/* What LOG_S does with the global logger */
+void logRecord(sl::Logger& logger, int sinkId, sl::Level level, int i) {
+  if (logger.isEnabled(sinkId, level))
+    logger.log(sinkId, level, "record % of %: %", i, kRecords, 0.5);
+}
+
+/* Allocations per record made by the calling thread, after the sink has
+   reached its steady state */
+double allocationsPerRecord(sl::Logger& logger, int sinkId, sl::Level level) {
+  for (int i = 0; i < kWarmUp; ++i) {
+    logRecord(logger, sinkId, level, i);
+  }
+  logger.flush(sinkId, false);
+
+  alloc::Scope scope;
+  for (int i = 0; i < kRecords; ++i) {
+    logRecord(logger, sinkId, level, i);
+  }
+  return (double)scope.allocations() / kRecords;
+}
+
+}
+
+TEST_CASE("Allocations") {
+  sl::Logger logger;
+  futils::TmpDir tmpDir;
+  const int kSinkId = 4501;
+  sl::SinkOptions options(1000 * 1000 * 100, 1000 * 1000 * 10);
+
+  SECTION("Counter") {
+    /* Catch allocates in REQUIRE, counts are taken before it */
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t otherThread = 0;
+    {
+      std::string kept;
+      alloc::Scope scope;
+      {
+        std::vector<int> v(10);
+        kept.assign(v.size() * 10, 'x');
+      }
+      allocations = scope.allocations();
+      deallocations = scope.deallocations();
+
+      std::thread thread([&otherThread, &kept] { 
+        alloc::Scope scope;
+        kept.assign(200, 'y');
+        otherThread = scope.allocations();
+      });
+      thread.join();
+    }
+    REQUIRE(allocations == 2);
+    REQUIRE(deallocations == 1);
+    REQUIRE(otherThread == 1);
+  }
+
+  SECTION("Synchronous") {
+    logger.addSink(kSinkId, tmpDir.name(), "sync", sl::Level::debug, options);
+    REQUIRE(allocationsPerRecord(logger, kSinkId, sl::Level::info) <= kFormatAllocations);
+  }
+
+  SECTION("Asynchronous") {
+    options.async = sl::AsyncOptions(10000);
+    logger.addSink(kSinkId, tmpDir.name(), "async", sl::Level::debug, options);
+    /* plus a deque block every few records */
+    REQUIRE(allocationsPerRecord(logger, kSinkId, sl::Level::info) < kFormatAllocations + 1);
+  }
+
+  SECTION("Per thread") {
+    options.async = sl::AsyncOptions(10000);
+    options.async.perThread = true;
+    logger.addSink(kSinkId, tmpDir.name(), "per_thread", sl::Level::debug, options);
+    REQUIRE(allocationsPerRecord(logger, kSinkId, sl::Level::info) <= kFormatAllocations);
+  }
+
+  SECTION("Below level") {
+    logger.addSink(kSinkId, tmpDir.name(), "filtered", sl::Level::error, options);
+    REQUIRE(allocationsPerRecord(logger, kSinkId, sl::Level::info) == 0);
+  }
+
+  SECTION("Backtrace") {
+    options.backtrace = sl::BacktraceOptions(100);
+    logger.addSink(kSinkId, tmpDir.name(), "backtrace", sl::Level::error, options);
+    /* the ring slots keep their buffers */
+    REQUIRE(allocationsPerRecord(logger, kSinkId, sl::Level::info) <= kFormatAllocations);
+  }
+}
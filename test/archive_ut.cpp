@@ -0,0 +1,111 @@
+#include <string>
+#include <fstream>
+#include "catch.hh"
+#include <log/archive.h>
+#include <log/utils.h>
+#include "file_utils.h"
+#include "random_utils.h"
+
+using namespace sl::detail;
+
+namespace {
+
+const int64_t kStartTime = 1500000000ll * 1000000;
+const int64_t kRecordInterval = 1000;
+
+/* Returns the file content, marks are made every kArchiveBlockSize bytes as
+   LogFilesManager does */
+std::string writeLogLike(const std::string& fileName, size_t records, BlockMarks* marks) {
+  RandomData randomData(5, 40);
+  std::string result;
+
+  for (size_t i = 0; i < records; ++i) {
+    if (marks->empty() || 
+        (int64_t)result.size() - marks->back().offset >= (int64_t)kArchiveBlockSize) {
+      marks->emplace_back(result.size(), kStartTime + i * kRecordInterval);
+    }
+    result += "2017-03-11 22:10:59.129     INFO 0x7fffa2ba73c0 message ";
+    result += std::to_string(i) + " " + randomData() + "\n\n";
+  }
+
+  std::ofstream ofs(fileName, std::ios::binary);
+  ofs << result;
+  return result;
+}
+
+int64_t archive(const std::string& rawName, 
+                const std::string& archiveName, 
+                const BlockMarks& marks,
+                size_t threads) {
+  FILE* in = fopen(rawName.c_str(), "rb");
+  REQUIRE(in != nullptr);
+  auto result = writeArchive(in, archiveName, marks, threads);
+  fclose(in);
+  return result;
+}
+
+}
+
+TEST_CASE("ArchiveTest", "[archive]") {
+  futils::TmpDir tmpDir;
+  auto rawName = fs::join(tmpDir.name(), "raw.log");
+  auto archiveName = fs::join(tmpDir.name(), "raw.log.lz");
+  BlockMarks marks;
+  auto data = writeLogLike(rawName, 50000, &marks);
+  REQUIRE(marks.size() > 10);
+
+  SECTION("round trip") {
+    for (size_t threads: {1, 4, 0}) {
+      auto size = archive(rawName, archiveName, marks, threads);
+      REQUIRE(size == futils::fileSize(archiveName));
+      REQUIRE(size < (int64_t)data.size() / 2);
+      REQUIRE(ArchiveReader::isArchive(archiveName));
+
+      ArchiveReader reader(archiveName);
+      REQUIRE(reader.blocks().size() == marks.size());
+      REQUIRE(reader.readAll() == data);
+    }
+    REQUIRE_FALSE(ArchiveReader::isArchive(rawName));
+    REQUIRE_THROWS(ArchiveReader(rawName).blocks());
+  }
+
+  SECTION("blocks") {
+    archive(rawName, archiveName, marks, 2);
+    ArchiveReader reader(archiveName);
+    for (size_t i = 0; i < marks.size(); ++i) {
+      REQUIRE(reader.blocks()[i].timestamp == marks[i].timestamp);
+      auto block = reader.readBlock(i);
+      REQUIRE(data.compare(marks[i].offset, block.size(), block) == 0);
+    }
+  }
+
+  SECTION("time range") {
+    archive(rawName, archiveName, marks, 2);
+    ArchiveReader reader(archiveName);
+    auto from = kStartTime + 20000 * kRecordInterval;
+    auto to = kStartTime + 20010 * kRecordInterval;
+    auto range = reader.read(from, to);
+
+    REQUIRE(range.size() < 3 * kArchiveBlockSize);
+    REQUIRE(range.find("message 20000 ") != std::string::npos);
+    REQUIRE(range.find("message 20009 ") != std::string::npos);
+    REQUIRE(reader.read(0, kStartTime).empty());
+    REQUIRE(reader.read(from, from + 1) != "");
+  }
+
+  SECTION("no marks") {
+    archive(rawName, archiveName, BlockMarks(), 3);
+    ArchiveReader reader(archiveName);
+    REQUIRE(reader.blocks().front().timestamp == -1);
+    REQUIRE(reader.read(kStartTime, kStartTime + 1) == data);
+  }
+
+  SECTION("empty") {
+    auto emptyName = fs::join(tmpDir.name(), "empty.log");
+    std::ofstream(emptyName).close();
+    archive(emptyName, archiveName, BlockMarks(), 1);
+    ArchiveReader reader(archiveName);
+    REQUIRE(reader.blocks().empty());
+    REQUIRE(reader.readAll().empty());
+  }
+}
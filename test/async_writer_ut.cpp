@@ -0,0 +1,90 @@
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <set>
+#include "catch.hh"
+#include <log/async_writer.h>
+#include <log/utils.h>
+
+using namespace sl::detail;
+
+TEST_CASE("AsyncWriterCallTest", "[async_writer]") {
+  sl::AsyncOptions options(1000);
+  std::vector<std::string> written;
+  std::thread::id writerId;
+  std::thread::id taskId;
+
+  auto check = [&] {
+    AsyncWriter writer(options,
+                       [&](const Record& record) {
+                         writerId = std::this_thread::get_id();
+                         written.push_back(record.data);
+                       },
+                       [](uint64_t) {});
+    for (int i = 0; i < 100; ++i) {
+      writer.push(Record(std::to_string(i), i, sl::Level::info));
+    }
+
+    /* runs after the records pushed before, on the writer thread */
+    writer.call([&] {
+      taskId = std::this_thread::get_id();
+      written.push_back("task");
+    });
+    REQUIRE(written.size() == 101);
+    REQUIRE(written.back() == "task");
+    REQUIRE(taskId == writerId);
+    REQUIRE(taskId != std::this_thread::get_id());
+  };
+
+  SECTION("queue") {
+    check();
+  }
+
+  SECTION("per thread") {
+    options.perThread = true;
+    check();
+  }
+}
+
+TEST_CASE("AsyncWriterTakenAtTest", "[async_writer]") {
+  const int kRecords = 20;
+  sl::AsyncOptions options(1000);
+  std::vector<int64_t> queued;
+  std::vector<int64_t> taken;
+
+  /* the records are stamped when the writer takes them, not when their
+     turn to be written comes after the slow writes before them */
+  auto check = [&] {
+    {
+      AsyncWriter writer(options,
+                         [&](const Record& record) {
+                           queued.push_back(record.queuedAt);
+                           taken.push_back(record.takenAt);
+                           std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                         },
+                         [](uint64_t) {});
+      for (int i = 0; i < kRecords; ++i) {
+        Record record(std::to_string(i), i, sl::Level::info);
+        record.loggedAt = record.queuedAt = ts::steadyNs();
+        writer.push(std::move(record));
+      }
+      writer.flush();
+    }
+
+    REQUIRE(taken.size() == kRecords);
+    for (int i = 0; i < kRecords; ++i) {
+      REQUIRE(taken[i] >= queued[i]);
+    }
+    REQUIRE(std::set<int64_t>(taken.begin(), taken.end()).size() < kRecords);
+  };
+
+  SECTION("queue") {
+    check();
+  }
+
+  SECTION("per thread") {
+    options.perThread = true;
+    check();
+  }
+}
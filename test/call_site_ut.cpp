@@ -0,0 +1,91 @@
+#define SL_PROFILE_CALL_SITES
+
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "catch.hh"
+#include "file_utils.h"
+#include <log/log.h>
+
+namespace {
+
+const int kSinkId = 4801;
+
+void logNoisy(int i) {
+  LOG_S(kSinkId, sl::Level::info, "noisy % %", std::to_string(i), std::string(100, 'x'));
+}
+
+void logQuiet(int i) {
+  LOG_S(kSinkId, sl::Level::info, "quiet %", std::to_string(i));
+}
+
+void logFiltered(int i) {
+  LOG_S(kSinkId, sl::Level::debug, "filtered %", std::to_string(i));
+}
+
+const sl::CallSiteStats* find(const std::vector<sl::CallSiteStats>& sites, 
+                              const std::string& format) {
+  for (const auto& site: sites) {
+    if (site.format == format)
+      return &site;
+  }
+  return nullptr;
+}
+
+}
+
+TEST_CASE("CallSites") {
+  auto& logger = sl::Logger::getLogger();
+  futils::TmpDir tmpDir;
+  if (!logger.hasSink(kSinkId)) {
+    logger.addSink(kSinkId, tmpDir.name(), "call_sites", sl::Level::info, 
+                   1000 * 1000 * 100, 1000 * 1000 * 10);
+  }
+  sl::resetCallSites();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 100; ++i) {
+        logNoisy(i);
+        logQuiet(i);
+        logFiltered(i);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+
+  auto sites = sl::topCallSites();
+  auto noisy = find(sites, "noisy % %");
+  auto quiet = find(sites, "quiet %");
+  auto filtered = find(sites, "filtered %");
+  REQUIRE(noisy != nullptr);
+  REQUIRE(quiet != nullptr);
+  REQUIRE(filtered != nullptr);
+
+  REQUIRE(noisy->hits == 400);
+  REQUIRE(noisy->filtered == 0);
+  REQUIRE(noisy->bytes > quiet->bytes + 400 * 100);
+  REQUIRE(noisy->line == 15);
+  REQUIRE(noisy->file.find("call_site_ut.cpp") != std::string::npos);
+  REQUIRE(quiet->hits == 400);
+  REQUIRE(filtered->hits == 0);
+  REQUIRE(filtered->bytes == 0);
+  REQUIRE(filtered->filtered == 400);
+
+  auto top = sl::topCallSites(2);
+  REQUIRE(top.size() == 2);
+  REQUIRE(top[0].format == "noisy % %");
+  REQUIRE(top[1].format == "quiet %");
+
+  std::stringstream dump;
+  sl::dumpTopCallSites(dump, 1);
+  auto lines = futils::splitBy(dump.str(), '\n');
+  REQUIRE(lines.size() == 1);
+  REQUIRE(lines[0] == std::to_string(noisy->bytes) + " 400 0 " + noisy->file + ":15 noisy % %");
+
+  sl::resetCallSites();
+  REQUIRE(sl::topCallSites(1)[0].hits == 0);
+}
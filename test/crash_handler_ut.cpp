@@ -0,0 +1,106 @@
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "catch.hh"
+#include <log/log.h>
+#include <log/crash_handler.h>
+#include <log/utils.h>
+#include "file_utils.h"
+
+#if defined (__unix__)
+  #include <unistd.h>
+  #include <signal.h>
+  #include <sys/wait.h>
+#endif
+
+using namespace sl::detail;
+
+#if defined (__unix__)
+
+namespace {
+
+std::string contentOf(const std::string& fileName) {
+  auto content = futils::fileContent(fileName);
+  return std::string(content.begin(), content.end());
+}
+
+}
+
+TEST_CASE("CrashHandlerFlushTest", "[crash_handler]") {
+  futils::TmpDir tmpDir;
+  FileEntryFactory factory;
+  LogFilesManager manager(
+      FileEntryCatalogPtr(new FileEntryCatalog(&factory, tmpDir.name(), "crash")),
+      sl::SinkOptions(1000 * 1000, 1000 * 1000));
+
+  /* the writer is stuck in the first record */
+  std::atomic<bool> entered(false);
+  std::atomic<bool> released(false);
+  AsyncWriter writer(sl::AsyncOptions(100), 
+                     [&](const Record& record) {
+                       entered = true;
+                       while (!released) {
+                         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                       }
+                       manager.write(record.data.data(), record.data.size(), 0);
+                     },
+                     [](uint64_t) {});
+  writer.push(Record("record 0\n\n", 0, sl::Level::info));
+  while (!entered) {
+    std::this_thread::yield();
+  }
+  writer.push(Record("record 1\n\n", 0, sl::Level::info));
+  writer.push(Record("record 2\n\n", 0, sl::Level::info));
+
+  {
+    CrashTarget target(&manager, &writer, nullptr);
+    emergencyFlush(SIGSEGV, 20);
+  }
+
+  auto content = contentOf(fs::join(tmpDir.name(), "crash.log"));
+  REQUIRE(content.find("record 1\n\nrecord 2\n\n") == 0);
+  REQUIRE(content.find("CRITICAL") != std::string::npos);
+  REQUIRE(content.find("sl: fatal signal " + std::to_string(SIGSEGV) + " (SIGSEGV)\n\n") != 
+          std::string::npos);
+  released = true;
+}
+
+TEST_CASE("CrashHandlerForkTest", "[crash_handler]") {
+  futils::TmpDir tmpDir;
+  const auto filePath = fs::join(tmpDir.name(), "crash.log");
+  const int kRecords = 1000;
+
+  pid_t pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    /* the test framework's handlers would report and exit instead */
+    for (int signal: {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+      ::signal(signal, SIG_DFL);
+    }
+
+    sl::Logger logger;
+    sl::SinkOptions options(1000 * 1000, 1000 * 1000);
+    options.async = sl::AsyncOptions(10 * 1000);
+    logger.addSink(1, tmpDir.name(), "crash", sl::Level::debug, options);
+    sl::installCrashHandler();
+    for (int i = 0; i < kRecords; ++i) {
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+    raise(SIGSEGV);
+    _exit(0);
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  REQUIRE(WIFSIGNALED(status));
+  REQUIRE(WTERMSIG(status) == SIGSEGV);
+
+  auto lines = futils::splitBy(contentOf(filePath), '\n');
+  REQUIRE(lines.size() == kRecords + 1);
+  REQUIRE(lines[kRecords - 1].find("message " + std::to_string(kRecords - 1)) != 
+          std::string::npos);
+  REQUIRE(lines[kRecords].find("sl: fatal signal") != std::string::npos);
+}
+
+#endif
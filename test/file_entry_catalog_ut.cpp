@@ -62,3 +62,98 @@ TEST_CASE("FileEntryCatalogTest", "[FileEntryCatalog]")
     REQUIRE(factory.get()[0]->size() == 0);
   }
 }
+
+TEST_CASE("FileEntryCatalogPeriodTest", "[FileEntryCatalog, period]")
+{
+  const int64_t kPeriodStart = 1500000000;
+  TestFileEntryFactory factory(100, 1);
+  FileEntryCatalog catalog(&factory, kPath, kBaseName);
+  auto periodName = str::join("/test/path/test-", 
+                              ts::format(kPeriodStart, "%Y%m%d-%H%M%S"));
+
+  REQUIRE_NOTHROW(catalog.rotate(kPeriodStart));
+  REQUIRE(catalog.size() == 2);
+  REQUIRE(factory.get()[0]->name() == periodName + ".log");
+  REQUIRE(catalog.first().name() == "/test/path/test.log");
+
+  /* same period once more */
+  REQUIRE_NOTHROW(catalog.rotate(kPeriodStart));
+  REQUIRE(catalog.size() == 3);
+  REQUIRE(catalog.first().name() == "/test/path/test.log");
+  
+  REQUIRE_NOTHROW(catalog.rotate(kPeriodStart));
+  REQUIRE(catalog.size() == 4);
+
+  /* the oldest one goes first */
+  REQUIRE(catalog.removeLast() == 100);
+  REQUIRE(catalog.size() == 3);
+}
+
+class OrderedFileEntryCatalog : public FileEntryCatalog {
+public:
+  using FileEntryCatalog::FileEntryCatalog;
+  const FileEntryList& entries() const { return FileEntryCatalog::entries(); }
+};
+
+TEST_CASE("FileEntryCatalogOrderTest", "[FileEntryCatalog, order]")
+{
+  const std::vector<std::string> kOrdered = {
+    "test.log",
+    "test-20170102-000000_1.log",
+    "test-20170102-000000.log",
+    "test-20170101-000000.log",
+    "test1.log",
+    "test2.log",
+    "test10.log"
+  };
+
+  futils::TmpDir tmpDir;
+  for (auto it = kOrdered.crbegin(); it != kOrdered.crend(); ++it) {
+    FileEntry(fs::join(tmpDir.name(), *it)).open();
+  }
+
+  FileEntryFactory factory;
+  OrderedFileEntryCatalog catalog(&factory, tmpDir.name(), kBaseName);
+
+  REQUIRE(catalog.entries().size() == kOrdered.size());
+  for (size_t i = 0; i < kOrdered.size(); ++i) {
+    REQUIRE(catalog.entries()[i]->name() == fs::join(tmpDir.name(), kOrdered[i]));
+  }
+}
+
+TEST_CASE("FileEntryCatalogExpiredTest", "[FileEntryCatalog, expired]")
+{
+  const size_t kEntriesCount = 5;
+  const int64_t kFileSize = 100;
+  const int64_t kTimeStep = 10;
+  TestFileEntryFactory factory(kFileSize, kEntriesCount, kTimeStep);
+  FileEntryCatalog catalog(&factory, kPath, kBaseName);
+
+  REQUIRE(catalog.oldestTime() == kLastModified - 40);
+  REQUIRE(catalog.removeExpired(kLastModified, 0, 0) == 0);
+  REQUIRE(catalog.size() == kEntriesCount);
+
+  SECTION("age") {
+    REQUIRE(catalog.removeExpired(kLastModified, 25, 0) == 2 * kFileSize);
+    REQUIRE(catalog.size() == kEntriesCount - 2);
+    REQUIRE(catalog.oldestTime() == kLastModified - 20);
+    REQUIRE(catalog.totalBytes() == (kEntriesCount - 2) * kFileSize);
+
+    /* the active file is never removed */
+    REQUIRE(catalog.removeExpired(kLastModified + 100, 25, 0) == 2 * kFileSize);
+    REQUIRE(catalog.size() == 1);
+    REQUIRE(catalog.oldestTime() == -1);
+    REQUIRE(catalog.first().name() == "/test/path/test.log");
+  }
+
+  SECTION("count") {
+    REQUIRE(catalog.removeExpired(kLastModified, 0, 2) == 3 * kFileSize);
+    REQUIRE(catalog.size() == 2);
+    REQUIRE(catalog.oldestTime() == kLastModified - 10);
+  }
+
+  SECTION("age and count") {
+    REQUIRE(catalog.removeExpired(kLastModified, 35, 3) == 2 * kFileSize);
+    REQUIRE(catalog.size() == 3);
+  }
+}
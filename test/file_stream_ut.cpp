@@ -30,3 +30,20 @@ TEST_CASE("FileStreamTest") {
     REQUIRE(content == tw.expectedContent());
   }
 }
+
+TEST_CASE("FileStreamWriteBackTest") {
+  futils::TmpDir tmpDir;
+  auto fname = fs::join(tmpDir.name(), "log_file");
+  FileStream stream(fname, 4096);
+
+  futils::TestWriter tw(stream);
+  tw.writeRandomData();
+  stream.close();
+  REQUIRE(futils::fileContent(fname) == tw.expectedContent());
+
+  /* reopened stream continues from the end of file */
+  stream.open();
+  tw.writeRandomData();
+  stream.close();
+  REQUIRE(futils::fileContent(fname) == tw.expectedContent());
+}
@@ -0,0 +1,92 @@
+#include <string>
+#include "catch.hh"
+#include <log/flight_recorder.h>
+#include <log/utils.h>
+#include "file_utils.h"
+
+#if defined (__unix__)
+  #include <unistd.h>
+  #include <sys/wait.h>
+  #include <stdlib.h>
+  #include <signal.h>
+#endif
+
+using namespace sl::detail;
+
+namespace {
+
+std::string record(int i) {
+  return "record " + std::to_string(i) + "\n\n";
+}
+
+}
+
+TEST_CASE("FlightRecorderTest", "[flight_recorder]") {
+  futils::TmpDir tmpDir;
+  const auto fileName = fs::join(tmpDir.name(), "test.flight");
+
+  SECTION("Recover") {
+    FlightRecorder recorder(fileName, 1000);
+    recorder.write(record(0).data(), record(0).size());
+    recorder.write(record(1).data(), record(1).size());
+    REQUIRE(FlightRecorder::recover(fileName) == record(0) + record(1));
+  }
+
+  SECTION("Wrap") {
+    std::string written;
+    {
+      FlightRecorder recorder(fileName, 100);
+      for (int i = 0; i < 100; ++i) {
+        recorder.write(record(i).data(), record(i).size());
+        written += record(i);
+      }
+    }
+
+    /* complete records only, the newest ones */
+    auto recovered = FlightRecorder::recover(fileName);
+    REQUIRE(recovered.size() <= 100);
+    REQUIRE(recovered.size() > 80);
+    REQUIRE(recovered.compare(0, 7, "record ") == 0);
+    REQUIRE(written.compare(written.size() - recovered.size(), 
+                            recovered.size(), recovered) == 0);
+  }
+
+  SECTION("Continue") {
+    {
+      FlightRecorder recorder(fileName, 1000);
+      recorder.write(record(0).data(), record(0).size());
+    }
+    {
+      FlightRecorder recorder(fileName, 1000);
+      recorder.write(record(1).data(), record(1).size());
+    }
+    REQUIRE(FlightRecorder::recover(fileName) == record(0) + record(1));
+
+    /* other capacity starts over */
+    FlightRecorder recorder(fileName, 500);
+    recorder.write(record(2).data(), record(2).size());
+    REQUIRE(FlightRecorder::recover(fileName) == record(2));
+  }
+
+  SECTION("Not a recorder") {
+    REQUIRE_THROWS(FlightRecorder::recover(fs::join(tmpDir.name(), "none.flight")));
+  }
+
+#if defined (__unix__)
+  SECTION("Crash") {
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+      FlightRecorder recorder(fileName, 1000);
+      recorder.write(record(0).data(), record(0).size());
+      signal(SIGABRT, SIG_DFL);
+      abort();
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    REQUIRE(WIFSIGNALED(status));
+    REQUIRE(FlightRecorder::recover(fileName) == record(0));
+  }
+#endif
+}
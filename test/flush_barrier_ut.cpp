@@ -0,0 +1,73 @@
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include "catch.hh"
+#include <log/flush_barrier.h>
+
+using namespace sl::detail;
+
+TEST_CASE("FlushBarrierTest", "[flush_barrier]") {
+  FlushBarrier barrier;
+  std::atomic<int> started(0);
+  std::atomic<int> finished(0);
+
+  auto action = [&] {
+    ++started;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ++finished;
+  };
+
+  SECTION("single") {
+    barrier.run(action);
+    barrier.run(action);
+    REQUIRE(finished == 2);
+  }
+
+  SECTION("batching") {
+    const int kThreads = 16;
+    std::atomic<bool> ok(true);
+    std::atomic<bool> released(false);
+    std::vector<std::thread> threads;
+
+    /* the first action is held until everyone else is waiting for it */
+    auto gated = [&] {
+      ++started;
+      while (!released) {
+        std::this_thread::yield();
+      }
+      ++finished;
+    };
+
+    threads.emplace_back([&] { barrier.run(gated); });
+    while (started != 1) {
+      std::this_thread::yield();
+    }
+    for (int i = 1; i < kThreads; ++i) {
+      threads.emplace_back([&] {
+        /* The action which has been running at the call doesn't count */
+        auto before = started.load();
+        barrier.run(gated);
+        if (finished <= before)
+          ok = false;
+      });
+    }
+    while (barrier.requested() != kThreads) {
+      std::this_thread::yield();
+    }
+    released = true;
+    for (auto& thread: threads) {
+      thread.join();
+    }
+
+    /* the waiters are served by a single run */
+    REQUIRE(ok);
+    REQUIRE(finished == 2);
+  }
+
+  SECTION("exceptions") {
+    REQUIRE_THROWS(barrier.run([] { throw std::runtime_error("sync failed"); }));
+    barrier.run(action);
+    REQUIRE(finished == 1);
+  }
+}
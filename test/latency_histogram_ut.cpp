@@ -0,0 +1,61 @@
+#include <thread>
+#include <vector>
+#include "catch.hh"
+#include <log/latency_histogram.h>
+
+using namespace sl::detail;
+
+TEST_CASE("LatencyHistogramTest", "[latency_histogram]") {
+  SECTION("Buckets") {
+    for (uint64_t value = 0; value < 100000; value += 7) {
+      auto bucket = AtomicHistogram::bucket(value);
+      REQUIRE(bucket < AtomicHistogram::kBuckets);
+      REQUIRE(AtomicHistogram::upperBound(bucket) >= (int64_t)value);
+      REQUIRE(AtomicHistogram::upperBound(bucket) <= (int64_t)(value + value / 8));
+      if (bucket != 0)
+        REQUIRE(AtomicHistogram::upperBound(bucket - 1) < (int64_t)value);
+    }
+    REQUIRE(AtomicHistogram::bucket(UINT64_MAX) == AtomicHistogram::kBuckets - 1);
+    REQUIRE(AtomicHistogram::upperBound(AtomicHistogram::kBuckets - 1) == INT64_MAX);
+  }
+
+  SECTION("Percentiles") {
+    AtomicHistogram histogram;
+    for (int64_t value = 1; value <= 1000; ++value) {
+      histogram.add(value);
+    }
+
+    auto snapshot = histogram.snapshot(false);
+    REQUIRE(snapshot.count == 1000);
+    REQUIRE(snapshot.max == 1000);
+    REQUIRE(snapshot.percentile(0.5) >= 500);
+    REQUIRE(snapshot.percentile(0.5) <= 500 + 500 / 8);
+    REQUIRE(snapshot.percentile(0.99) >= 990);
+    REQUIRE(snapshot.percentile(1) == 1000);
+    REQUIRE(sl::LatencyHistogram().percentile(0.5) == 0);
+  }
+
+  SECTION("Reset") {
+    AtomicHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&histogram] {
+        for (int i = 0; i < 10000; ++i) {
+          histogram.add(i);
+        }
+      });
+    }
+
+    uint64_t counted = 0;
+    for (int i = 0; i < 100; ++i) {
+      counted += histogram.snapshot(true).count;
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    counted += histogram.snapshot(true).count;
+
+    REQUIRE(counted == 40000);
+    REQUIRE(histogram.snapshot(false).count == 0);
+  }
+}
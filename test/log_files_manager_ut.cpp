@@ -1,8 +1,14 @@
 #include <assert.h>
 #include <string.h>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <errno.h>
 #include "catch.hh"
 #include <log/log_files_manager.h>
 #include <log/file_entry.h>
+#include <log/archive.h>
+#include <log/utils.h>
 #include "file_utils.h"
 #include "test_common.h"
 
@@ -12,6 +18,9 @@ class TestLogFilesManager : public LogFilesManager {
 public:
   using LogFilesManager::LogFilesManager;
   const FileStreamPtr& stream() const { return LogFilesManager::stream(); }
+  size_t housekeeperTasks() const {
+    return housekeeperWorker() ? housekeeperWorker()->pending() : 0;
+  }
 };
 
 class TestFileEntryCatalog : public FileEntryCatalog {
@@ -35,27 +44,261 @@ TEST_CASE("LogFilesManager") {
   REQUIRE(catalogPtr->entries().size() == 1);
 
   SECTION("Write below file limit") {
-    manager.write(nullptr, 70);
+    manager.write(nullptr, 70, 0);
     REQUIRE(catalogPtr->entries().size() == 1);
     REQUIRE(static_cast<TestFileStream*>(manager.stream().get())->written == 70);
   }
 
   SECTION("Write beyond file limit") {
-    manager.write(nullptr, 101);
+    manager.write(nullptr, 101, 0);
     REQUIRE(catalogPtr->entries().size() == 2);
   }
 
   SECTION("Write beyond total limit") {
-    manager.write(nullptr, 50);
+    manager.write(nullptr, 50, 0);
     REQUIRE(catalogPtr->entries().size() == 1);
     
-    manager.write(nullptr, 101);
+    manager.write(nullptr, 101, 0);
     REQUIRE(catalogPtr->entries().size() == 2);
 
-    manager.write(nullptr, 101);
+    manager.write(nullptr, 101, 0);
     REQUIRE(catalogPtr->entries().size() == 3);
 
-    manager.write(nullptr, 101);
+    manager.write(nullptr, 101, 0);
     REQUIRE(catalogPtr->entries().size() == 3);
   }
 }
+
+TEST_CASE("LogFilesManagerRetention") {
+  const int64_t kTotalLimit = 10000;
+  const int64_t kFileLimit = 100;
+
+  TestFileEntryFactory factory(kFileLimit, 5, 10);
+  FileEntryCatalogPtr catalog(new TestFileEntryCatalog(&factory, kPath, kBaseName));
+  TestFileEntryCatalog* catalogPtr = static_cast<TestFileEntryCatalog*>(catalog.get());
+
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+  options.retention = sl::RetentionOptions(0, 3);
+  TestLogFilesManager manager(std::move(catalog), options);
+
+  auto waitForSize = [catalogPtr](size_t size) {
+    for (int i = 0; i < 500 && catalogPtr->size() != size; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return catalogPtr->size() == size;
+  };
+
+  /* the excess is removed in the background */
+  REQUIRE(waitForSize(3));
+
+  manager.write(nullptr, 50, 0);
+  manager.write(nullptr, 101, 0);
+  REQUIRE(waitForSize(3));
+}
+
+TEST_CASE("LogFilesManagerRetentionTasks") {
+  const int64_t kTotalLimit = 1000000;
+  const int64_t kFileLimit = 100;
+  const int kRotations = 20;
+
+  TestFileEntryFactory factory(kFileLimit, 3);
+  FileEntryCatalogPtr catalog(new TestFileEntryCatalog(&factory, kPath, kBaseName));
+
+  /* nothing expires, the age check stays armed far in the future */
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+  options.retention = sl::RetentionOptions(100ll * 365 * 24 * 3600, 0);
+  TestLogFilesManager manager(std::move(catalog), options);
+
+  auto waitForTasks = [&manager](size_t tasks) {
+    for (int i = 0; i < 500 && manager.housekeeperTasks() != tasks; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return manager.housekeeperTasks();
+  };
+
+  REQUIRE(waitForTasks(1) == 1);
+  for (int i = 0; i < kRotations; ++i) {
+    manager.write(nullptr, 101, 0);
+  }
+  /* the checks posted by the rotations do not start new chains */
+  REQUIRE(waitForTasks(1) == 1);
+}
+
+TEST_CASE("LogFilesManagerDurability") {
+  const int64_t kTotalLimit = 10000;
+  const int64_t kFileLimit = 100;
+
+  TestFileEntryFactory factory(0, 0);
+  FileEntryCatalogPtr catalog(new TestFileEntryCatalog(&factory, kPath, kBaseName));
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+
+  SECTION("Flush") {
+    TestLogFilesManager manager(std::move(catalog), options);
+    auto stream = static_cast<TestFileStream*>(manager.stream().get());
+
+    manager.write(nullptr, 10, 0);
+    manager.flush(false);
+    REQUIRE(stream->syncs == 0);
+    manager.flush(true);
+    REQUIRE(stream->syncs == 1);
+  }
+
+  SECTION("Periodic") {
+    options.durability = sl::DurabilityOptions(sl::Durability::periodic, 5);
+    TestLogFilesManager manager(std::move(catalog), options);
+    auto stream = static_cast<TestFileStream*>(manager.stream().get());
+
+    manager.write(nullptr, 10, 0);
+    for (int i = 0; i < 500 && stream->syncs < 2; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(stream->syncs >= 2);
+  }
+
+  SECTION("Invalid interval") {
+    options.durability = sl::DurabilityOptions(sl::Durability::periodic, 0);
+    REQUIRE_THROWS(TestLogFilesManager(std::move(catalog), options));
+  }
+}
+
+TEST_CASE("LogFilesManagerErrors") {
+  const int64_t kTotalLimit = 10000;
+  const int64_t kFileLimit = 100;
+
+  TestFileEntryFactory factory(0, 0);
+  FileEntryCatalogPtr catalog(new TestFileEntryCatalog(&factory, kPath, kBaseName));
+  futils::TmpDir spillDir;
+  std::mutex mutex;
+  std::vector<sl::SinkError> reported;
+
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+  options.errors.retryInterval = 5;
+  options.errors.handler = [&](const sl::SinkError& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    reported.push_back(error);
+  };
+
+  auto waitForReports = [&](size_t count) {
+    for (int i = 0; i < 500; ++i) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (reported.size() >= count)
+          return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  SECTION("Drop and recover") {
+    TestLogFilesManager manager(std::move(catalog), options);
+    static_cast<TestFileStream*>(manager.stream().get())->error = ENOSPC;
+
+    REQUIRE_NOTHROW(manager.write(nullptr, 10, 0));
+    REQUIRE_NOTHROW(manager.write(nullptr, 10, 0));
+    auto stats = manager.errorStats();
+    REQUIRE(stats.errors == 1);
+    REQUIRE(stats.dropped == 2);
+    REQUIRE(stats.degraded);
+
+    /* the reopened stream works */
+    waitForReports(2);
+    REQUIRE(!manager.errorStats().degraded);
+    std::lock_guard<std::mutex> lock(mutex);
+    REQUIRE(reported.size() == 2);
+    REQUIRE(reported[0].code == ENOSPC);
+    REQUIRE(!reported[0].recovered);
+    REQUIRE(reported[1].recovered);
+    REQUIRE(static_cast<TestFileStream*>(manager.stream().get())->written > 0);
+  }
+
+  SECTION("Spill") {
+    options.errors.retryInterval = 60 * 1000;
+    options.errors.spillDir = spillDir.name();
+    options.errors.spillLimit = 15;
+    TestLogFilesManager manager(std::move(catalog), options);
+    static_cast<TestFileStream*>(manager.stream().get())->error = EIO;
+
+    const std::string kRecord = "record\n";
+    manager.write(kRecord.data(), kRecord.size(), 0);
+    manager.write(kRecord.data(), kRecord.size(), 0);
+    manager.write(kRecord.data(), kRecord.size(), 0);
+
+    auto stats = manager.errorStats();
+    REQUIRE(stats.spilled == 2);
+    REQUIRE(stats.dropped == 1);
+    REQUIRE(futils::fileSize(fs::join(spillDir.name(), kBaseName + ".spill.log")) == 
+            (int64_t)kRecord.size() * 2);
+  }
+}
+
+TEST_CASE("LogFilesManagerCompression") {
+  const int64_t kTotalLimit = 1000 * 1000;
+  const int64_t kFileLimit = 10 * 1000;
+
+  futils::TmpDir tmpDir;
+  FileEntryFactory factory;
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+  options.compression = sl::Compression::lz;
+  LogFilesManager manager(
+      FileEntryCatalogPtr(new FileEntryCatalog(&factory, tmpDir.name(), kBaseName)),
+      options);
+
+  const std::string kRecord = "2017-03-11 22:10:59.129     INFO 0x7fffa2ba73c0 message\n\n";
+  std::string expected;
+  while ((int64_t)expected.size() < kFileLimit) {
+    manager.write(kRecord.data(), kRecord.size(), 0);
+    expected += kRecord;
+  }
+
+  auto compressedName = fs::join(tmpDir.name(), kBaseName + "1.log.lz");
+  for (int i = 0; i < 500 && !futils::fileExists(compressedName); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  REQUIRE(futils::fileExists(compressedName));
+  REQUIRE(!futils::fileExists(fs::join(tmpDir.name(), kBaseName + "1.log")));
+  REQUIRE(futils::fileSize(compressedName) < (int64_t)expected.size() / 5);
+
+  ArchiveReader reader(compressedName);
+  REQUIRE(reader.readAll() == expected);
+}
+
+TEST_CASE("LogFilesManagerCompressionRestart") {
+  const int64_t kTotalLimit = 1000 * 1000;
+  const int64_t kFileLimit = 10 * 1000;
+
+  futils::TmpDir tmpDir;
+  FileEntryFactory factory;
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+  options.compression = sl::Compression::lz;
+  const auto plainName = fs::join(tmpDir.name(), kBaseName + "1.log");
+  const auto compressedName = str::join(plainName, ".lz");
+
+  const std::string kRecord = "2017-03-11 22:10:59.129     INFO 0x7fffa2ba73c0 message\n\n";
+  std::string expected;
+  {
+    LogFilesManager manager(
+        FileEntryCatalogPtr(new FileEntryCatalog(&factory, tmpDir.name(), kBaseName)),
+        options);
+    while ((int64_t)expected.size() < kFileLimit) {
+      manager.write(kRecord.data(), kRecord.size(), 0);
+      expected += kRecord;
+    }
+    for (int i = 0; i < 500 && !futils::fileExists(compressedName); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  /* stopped between replacing the original and the rename */
+  REQUIRE(::rename(compressedName.c_str(), plainName.c_str()) == 0);
+  {
+    LogFilesManager manager(
+        FileEntryCatalogPtr(new FileEntryCatalog(&factory, tmpDir.name(), kBaseName)),
+        options);
+  }
+
+  REQUIRE(futils::fileExists(compressedName));
+  REQUIRE(!futils::fileExists(plainName));
+  ArchiveReader reader(compressedName);
+  REQUIRE(reader.readAll() == expected);
+}
@@ -5,6 +5,8 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
 #include "random_utils.h"
 
 const int64_t kTotalLimit = 10000;
@@ -237,6 +239,437 @@ TEST_CASE("Logger") {
   }
 }
 
+TEST_CASE("LoggerAsync") {
+  TestLogger logger;
+  futils::TmpDir tmpDir;
+  const std::string kFileName("async");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+
+  sl::SinkOptions options(kTotalLimit * 100, kTotalLimit * 10);
+
+  SECTION("Flush") {
+    options.async = sl::AsyncOptions(1000);
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::debug, options);
+    for (int i = 0; i < 100; ++i) {
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+    logger.flush(1, false);
+
+    auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+    REQUIRE(fileStrings.size() == 100);
+    checkLogOutput(fileStrings[99], sl::Level::info, "message 99");
+    REQUIRE(logger.queueStats(1).written == 100);
+  }
+
+  SECTION("Priority lane") {
+    options.async = sl::AsyncOptions(1000);
+    options.async.priorityQueueSize = 10;
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::debug, options);
+    logger.log(1, sl::Level::info, "first");
+    logger.log(1, sl::Level::critical, "second");
+    logger.flush(1, false);
+
+    auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+    REQUIRE(fileStrings.size() == 2);
+    std::set<std::string> sequences;
+    for (const auto& line: fileStrings) {
+      sequences.insert(futils::splitBy(line, ' ')[3]);
+    }
+    REQUIRE(sequences == std::set<std::string>({"#1", "#2"}));
+  }
+
+  SECTION("Per thread") {
+    options.async = sl::AsyncOptions(1000);
+    options.async.perThread = true;
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::debug, options);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&logger] {
+        for (int i = 0; i < 100; ++i) {
+          logger.log(1, sl::Level::info, "message %", std::to_string(i));
+        }
+      });
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    logger.flush(1, false);
+
+    REQUIRE(futils::splitBy(futils::fileContent(filePath), '\n').size() == 400);
+    REQUIRE(logger.queueStats(1).written == 400);
+  }
+
+  SECTION("Dropped notice") {
+    options.async = sl::AsyncOptions(1, sl::OverflowPolicy::dropNewest);
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::debug, options);
+    for (int i = 0; i < 1000; ++i) {
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+    logger.flush(1, false);
+
+    auto stats = logger.queueStats(1);
+    REQUIRE(stats.dropped > 0);
+    REQUIRE(stats.written + stats.dropped == 1000);
+
+    /* the notices are written once the queue has drained, their counts
+       are decimal and add up to the dropped ones */
+    auto noticed = [&filePath] {
+      uint64_t result = 0;
+      for (const auto& line: futils::splitBy(futils::fileContent(filePath), '\n')) {
+        auto pos = line.find(" records dropped");
+        if (pos == std::string::npos)
+          continue;
+        auto start = line.rfind(' ', pos - 1) + 1;
+        auto count = line.substr(start, pos - start);
+        REQUIRE(count.find_first_not_of("0123456789") == std::string::npos);
+        result += std::stoull(count);
+      }
+      return result;
+    };
+    for (int i = 0; i < 500 && noticed() != stats.dropped; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto noticedCount = noticed();
+    REQUIRE(noticedCount == stats.dropped);
+  }
+}
+
+TEST_CASE("LoggerBacktrace") {
+  TestLogger logger;
+  futils::TmpDir tmpDir;
+  const std::string kFileName("backtrace");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+
+  sl::SinkOptions options(kTotalLimit * 100, kTotalLimit * 10);
+  options.backtrace = sl::BacktraceOptions(3);
+  logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+  REQUIRE(logger.isEnabled(1, sl::Level::debug));
+
+  for (int i = 0; i < 5; ++i) {
+    logger.log(1, sl::Level::debug, "debug %", std::to_string(i));
+  }
+  logger.log(1, sl::Level::info, "info");
+
+  SECTION("Trigger") {
+    logger.log(1, sl::Level::error, "error");
+
+    auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+    REQUIRE(fileStrings.size() == 5);
+    checkLogOutput(fileStrings[0], sl::Level::info, "info");
+    checkLogOutput(fileStrings[1], sl::Level::debug, "debug 2");
+    checkLogOutput(fileStrings[3], sl::Level::debug, "debug 4");
+    checkLogOutput(fileStrings[4], sl::Level::error, "error");
+
+    /* the ring is emptied by the dump */
+    logger.log(1, sl::Level::critical, "critical");
+    REQUIRE(futils::splitBy(futils::fileContent(filePath), '\n').size() == 6);
+  }
+
+  SECTION("Explicit dump") {
+    logger.dumpBacktrace(1);
+
+    auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+    REQUIRE(fileStrings.size() == 4);
+    checkLogOutput(fileStrings[1], sl::Level::debug, "debug 2");
+  }
+}
+
+TEST_CASE("LoggerFlightRecorder") {
+  TestLogger logger;
+  futils::TmpDir tmpDir;
+  const std::string kFileName("recorder");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+
+  sl::SinkOptions options(kTotalLimit * 100, kTotalLimit * 10);
+  options.async = sl::AsyncOptions(1000);
+  options.flightRecorder = sl::FlightRecorderOptions(64 * 1024);
+  logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+  logger.log(1, sl::Level::debug, "debug");
+  logger.log(1, sl::Level::info, "info");
+
+  /* recorded before the writer has got them */
+  auto recorded = futils::splitBy(
+      sl::detail::FlightRecorder::recover(fs::join(tmpDir.name(), "." + kFileName + ".flight")), '\n');
+  REQUIRE(recorded.size() == 2);
+  checkLogOutput(recorded[0], sl::Level::debug, "debug");
+  checkLogOutput(recorded[1], sl::Level::info, "info");
+
+  logger.flush(1, false);
+  auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+  REQUIRE(fileStrings.size() == 1);
+  checkLogOutput(fileStrings[0], sl::Level::info, "info");
+}
+
+TEST_CASE("LoggerFlightRecorderRestart") {
+  futils::TmpDir tmpDir;
+  const std::string kFileName("recorder");
+  const auto recorderPath = fs::join(tmpDir.name(), "." + kFileName + ".flight");
+
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+  options.flightRecorder = sl::FlightRecorderOptions(64 * 1024);
+  {
+    TestLogger logger;
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+    logger.log(1, sl::Level::info, "before restart");
+  }
+
+  /* the catalog of the restarted sink must not pick the recorder up,
+     the rotations and the total limit leave it in place */
+  TestLogger logger;
+  logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+  for (int i = 0; i < 500; ++i)
+    logger.log(1, sl::Level::info, "after restart ", i);
+  logger.flush(1, false);
+
+  REQUIRE(futils::fileExists(recorderPath));
+  size_t logFiles = 0;
+  bool recorderInCatalog = false;
+  tmpDir.forEachEntry([&](const fs::Dir::Entry& entry) {
+    if (fs::globMatch(entry.name.c_str(), (kFileName + '*').c_str())) {
+      ++logFiles;
+      recorderInCatalog |= entry.name.find(".flight") != std::string::npos;
+    }
+  });
+  REQUIRE(logFiles > 1);
+  REQUIRE(!recorderInCatalog);
+
+  auto recorded = futils::splitBy(sl::detail::FlightRecorder::recover(recorderPath), '\n');
+  REQUIRE(!recorded.empty());
+  checkLogOutput(recorded.back(), sl::Level::info, "after restart 499");
+}
+
+TEST_CASE("LoggerStats") {
+  TestLogger logger;
+  futils::TmpDir tmpDir;
+  const std::string kFileName("stats");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+
+  sl::SinkOptions options(kTotalLimit, kFileLimit);
+
+  SECTION("Counters") {
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+    for (int i = 0; i < 500; ++i) {
+      if (logger.isEnabled(1, sl::Level::debug))
+        logger.log(1, sl::Level::debug, "debug");
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+
+    auto stats = logger.stats(1);
+    REQUIRE(stats.written == 500);
+    REQUIRE(stats.filtered == 500);
+    REQUIRE(stats.dropped == 0);
+    REQUIRE(stats.writeErrors == 0);
+    REQUIRE(stats.rotations > 0);
+    REQUIRE(stats.bytes > (uint64_t)kTotalLimit);
+    /* the total limit keeps the sum of the files under it */
+    REQUIRE(stats.deletions > 0);
+    REQUIRE(stats.writeTime > 0);
+    REQUIRE(stats.rotationTime > 0);
+    REQUIRE(stats.maxQueueDepth == 0);
+  }
+
+  SECTION("Queue") {
+    options.async = sl::AsyncOptions(1, sl::OverflowPolicy::dropNewest);
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+    for (int i = 0; i < 1000; ++i) {
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+    logger.flush(1, false);
+
+    auto stats = logger.stats(1);
+    auto queueStats = logger.queueStats(1);
+    REQUIRE(stats.dropped == queueStats.dropped);
+    REQUIRE(stats.maxQueueDepth == 1);
+    REQUIRE(stats.written >= queueStats.written);
+  }
+
+  SECTION("Periodic record") {
+    options = sl::SinkOptions(kTotalLimit * 100, kTotalLimit * 10);
+    options.statsInterval = 10;
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::error, options);
+    logger.log(1, sl::Level::error, "error");
+
+    std::string content;
+    for (int i = 0; i < 500 && content.find("sl: stats") == std::string::npos; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      auto data = futils::fileContent(filePath);
+      content.assign(data.begin(), data.end());
+    }
+    REQUIRE(content.find("sl: stats written=1 filtered=0") != std::string::npos);
+  }
+}
+
+TEST_CASE("LoggerLatency") {
+  TestLogger logger;
+  futils::TmpDir tmpDir;
+
+  sl::SinkOptions options(kTotalLimit * 100, kTotalLimit * 10);
+  options.latencyHistograms = true;
+
+  SECTION("Synchronous") {
+    logger.addSink(1, tmpDir.name(), "sync", sl::Level::info, options);
+    for (int i = 0; i < 100; ++i) {
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+
+    auto stats = logger.latencyStats(1, true);
+    REQUIRE(stats.format.count == 100);
+    REQUIRE(stats.lock.count == 100);
+    REQUIRE(stats.queue.count == 0);
+    REQUIRE(stats.write.count == 100);
+    REQUIRE(stats.total.count == 100);
+    REQUIRE(stats.total.max >= stats.write.max);
+    REQUIRE(stats.total.percentile(0.5) > 0);
+
+    REQUIRE(logger.latencyStats(1).total.count == 0);
+  }
+
+  SECTION("Asynchronous") {
+    options.async = sl::AsyncOptions(1000);
+    logger.addSink(1, tmpDir.name(), "async", sl::Level::info, options);
+    for (int i = 0; i < 100; ++i) {
+      logger.log(1, sl::Level::info, "message %", std::to_string(i));
+    }
+    logger.flush(1, false);
+
+    auto stats = logger.latencyStats(1);
+    REQUIRE(stats.format.count == 100);
+    REQUIRE(stats.lock.count == 0);
+    REQUIRE(stats.queue.count == 100);
+    REQUIRE(stats.write.count == 100);
+    REQUIRE(stats.total.count == 100);
+  }
+
+  SECTION("Disabled") {
+    options.latencyHistograms = false;
+    logger.addSink(1, tmpDir.name(), "disabled", sl::Level::info, options);
+    logger.log(1, sl::Level::info, "message");
+    REQUIRE(logger.latencyStats(1).total.count == 0);
+  }
+}
+
+TEST_CASE("LoggerRepeats") {
+  TestLogger logger;
+  futils::TmpDir tmpDir;
+  const std::string kFileName("repeats");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+
+  sl::SinkOptions options(kTotalLimit * 100, kTotalLimit * 10);
+  options.suppressRepeats = true;
+
+  auto check = [&] {
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+    for (int i = 0; i < 100; ++i) {
+      logger.log(1, sl::Level::error, "connection % refused", "10.0.0.1");
+    }
+    logger.log(1, sl::Level::info, "connected");
+    logger.log(1, sl::Level::info, "connected");
+    logger.log(1, sl::Level::info, "connected");
+    logger.flush(1, false);
+
+    auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+    REQUIRE(fileStrings.size() == 4);
+    checkLogOutput(fileStrings[0], sl::Level::error, "connection 10.0.0.1 refused");
+    checkLogOutput(fileStrings[1], sl::Level::error, "last message repeated 99 times");
+    checkLogOutput(fileStrings[2], sl::Level::info, "connected");
+    checkLogOutput(fileStrings[3], sl::Level::info, "last message repeated 2 times");
+
+    /* nothing left to report */
+    logger.flush(1, false);
+    REQUIRE(futils::splitBy(futils::fileContent(filePath), '\n').size() == 4);
+  };
+
+  SECTION("Synchronous") {
+    check();
+  }
+
+  SECTION("Asynchronous") {
+    options.async = sl::AsyncOptions(1000);
+    check();
+  }
+}
+
+TEST_CASE("LoggerRepeatsOrder") {
+  futils::TmpDir tmpDir;
+  const std::string kFileName("repeats");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+  const int kMessages = 3000;
+
+  sl::SinkOptions options(kTotalLimit * 1000, kTotalLimit * 1000);
+  options.suppressRepeats = true;
+  options.async = sl::AsyncOptions(1000);
+
+  /* the flushes report the repeats on the writer thread, so each report
+     follows the record it counts */
+  {
+    TestLogger logger;
+    logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+    std::atomic<bool> done(false);
+    std::thread flusher([&] {
+      while (!done) {
+        logger.flush(1, false);
+      }
+    });
+    for (int i = 0; i < kMessages; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        logger.log(1, sl::Level::info, "message %", std::to_string(i));
+      }
+    }
+    done = true;
+    flusher.join();
+    /* the repeats of the last one are reported on destruction */
+  }
+
+  std::vector<int> repeats(kMessages, -1);
+  int current = -1;
+  for (const auto& line: futils::splitBy(futils::fileContent(filePath), '\n')) {
+    auto repeated = line.find("last message repeated ");
+    if (repeated != std::string::npos) {
+      REQUIRE(current != -1);
+      repeats[current] += std::stoi(line.substr(repeated + 22));
+      continue;
+    }
+    current = std::stoi(line.substr(line.find("message ") + 8));
+    REQUIRE(repeats[current] == -1);
+    repeats[current] = 0;
+  }
+  REQUIRE(std::count(repeats.begin(), repeats.end(), 2) == kMessages);
+}
+
+TEST_CASE("LoggerRepeatsDestruction") {
+  futils::TmpDir tmpDir;
+  const std::string kFileName("repeats");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+
+  sl::SinkOptions options(kTotalLimit * 100, kTotalLimit * 10);
+  options.suppressRepeats = true;
+
+  auto check = [&] {
+    {
+      TestLogger logger;
+      logger.addSink(1, tmpDir.name(), kFileName, sl::Level::info, options);
+      for (int i = 0; i < 10; ++i) {
+        logger.log(1, sl::Level::warning, "disk almost full");
+      }
+    }
+
+    auto fileStrings = futils::splitBy(futils::fileContent(filePath), '\n');
+    REQUIRE(fileStrings.size() == 2);
+    checkLogOutput(fileStrings[0], sl::Level::warning, "disk almost full");
+    checkLogOutput(fileStrings[1], sl::Level::warning, "last message repeated 9 times");
+  };
+
+  SECTION("Synchronous") {
+    check();
+  }
+
+  SECTION("Asynchronous") {
+    options.async = sl::AsyncOptions(1000);
+    check();
+  }
+}
+
 TEST_CASE("LogMacros") {
   futils::TmpDir tmpDir;
 
@@ -0,0 +1,49 @@
+#include <vector>
+#include <string>
+#include "catch.hh"
+#include <log/lz.h>
+#include "random_utils.h"
+
+using namespace sl::detail;
+
+namespace {
+
+std::string logLikeData(size_t records) {
+  RandomData randomData(5, 40);
+  std::string result;
+  for (size_t i = 0; i < records; ++i) {
+    result += "2017-03-11 22:10:59.129     INFO 0x7fffa2ba73c0 message ";
+    result += std::to_string(i) + " " + randomData() + "\n\n";
+  }
+  return result;
+}
+
+void checkRoundTrip(const std::string& data) {
+  std::vector<char> compressed(lz::compressBound(data.size()));
+  auto size = lz::compress(data.data(), data.size(), compressed.data());
+  REQUIRE(size <= compressed.size());
+
+  std::vector<char> decompressed(data.size());
+  REQUIRE(lz::decompress(compressed.data(), size, decompressed.data(), data.size()));
+  REQUIRE(std::string(decompressed.data(), decompressed.size()) == data);
+}
+
+}
+
+TEST_CASE("LzBlockTest", "[lz]") {
+  checkRoundTrip("");
+  checkRoundTrip("a");
+  checkRoundTrip("abcdefghijklm");
+  checkRoundTrip(std::string(100000, 'x'));
+  checkRoundTrip(RandomData(1000, 2000)());
+  checkRoundTrip(logLikeData(1000));
+
+  auto data = logLikeData(1000);
+  std::vector<char> compressed(lz::compressBound(data.size()));
+  auto size = lz::compress(data.data(), data.size(), compressed.data());
+  REQUIRE(size < data.size() / 2);
+
+  std::vector<char> decompressed(data.size());
+  REQUIRE_FALSE(lz::decompress(compressed.data(), size - 1, decompressed.data(), data.size()));
+  REQUIRE_FALSE(lz::decompress(compressed.data(), size, decompressed.data(), data.size() - 1));
+}
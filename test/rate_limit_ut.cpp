@@ -0,0 +1,129 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "catch.hh"
+#include "file_utils.h"
+#include <log/log.h>
+#include <log/rate_limit.h>
+
+using namespace sl::detail;
+
+namespace {
+
+template<typename Limiter>
+int allowed(Limiter& limiter, int calls, uint64_t* reported = nullptr) {
+  int result = 0;
+  for (int i = 0; i < calls; ++i) {
+    uint64_t suppressed = 0;
+    if (limiter.allow(suppressed)) {
+      ++result;
+      if (reported)
+        *reported += suppressed;
+    }
+  }
+  return result;
+}
+
+}
+
+TEST_CASE("RateLimitTest", "[rate_limit]") {
+  SECTION("Every n") {
+    EveryN limiter(10);
+    REQUIRE(allowed(limiter, 100) == 10);
+    EveryN zero(0);
+    REQUIRE(allowed(zero, 5) == 5);
+  }
+
+  SECTION("First n") {
+    FirstN limiter(5);
+    std::vector<std::thread> threads;
+    std::atomic<int> total(0);
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&limiter, &total] { total += allowed(limiter, 100); });
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    REQUIRE(total == 5);
+  }
+
+  SECTION("Every t") {
+    EveryT limiter(50);
+    REQUIRE(allowed(limiter, 100) == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    uint64_t suppressed = 0;
+    REQUIRE(allowed(limiter, 1, &suppressed) == 1);
+    REQUIRE(suppressed == 99);
+  }
+
+  SECTION("Token bucket") {
+    RateLimit limiter(20, 5);
+    REQUIRE(allowed(limiter, 100) == 5);
+
+    /* 20 per second refills a token every 50 ms */
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    uint64_t suppressed = 0;
+    auto refilled = allowed(limiter, 100, &suppressed);
+    REQUIRE(refilled >= 2);
+    REQUIRE(refilled < 5);
+    REQUIRE(suppressed == 95);
+  }
+
+  SECTION("No refill") {
+    RateLimit limiter(0, 10);
+    REQUIRE(allowed(limiter, 100) == 10);
+    RateLimit single(-1, 1);
+    REQUIRE(allowed(single, 100) == 1);
+
+    /* the bucket span saturates at kMaxSpan instead of overflowing, a
+       token a kMaxSpan holds two */
+    RateLimit slow(1e-12, 1000);
+    REQUIRE(allowed(slow, 100) == 2);
+  }
+}
+
+TEST_CASE("RateLimitMacros") {
+  auto& logger = sl::Logger::getLogger();
+  futils::TmpDir tmpDir;
+  const int kSinkId = 4901;
+  const std::string kFileName("rate_limit");
+  const auto filePath = fs::join(tmpDir.name(), str::join(kFileName, ".log"));
+  logger.addSink(kSinkId, tmpDir.name(), kFileName, sl::Level::info, 
+                 1000 * 1000 * 100, 1000 * 1000 * 10);
+
+  auto lines = [&filePath] { return futils::splitBy(futils::fileContent(filePath), '\n'); };
+
+  for (int i = 0; i < 100; ++i) {
+    LOG_S_EVERY_N(kSinkId, 10, sl::Level::info, "every n %", std::to_string(i));
+  }
+  auto fileStrings = lines();
+  REQUIRE(fileStrings.size() == 10);
+  REQUIRE(fileStrings[1].find("every n 10") != std::string::npos);
+
+  /* disabled records don't use the limit up */
+  for (int i = 0; i < 100; ++i) {
+    LOG_S_FIRST_N(kSinkId, 3, i < 50 ? sl::Level::debug : sl::Level::info, 
+                  "first n %", std::to_string(i));
+  }
+  fileStrings = lines();
+  REQUIRE(fileStrings.size() == 13);
+  REQUIRE(fileStrings[10].find("first n 50") != std::string::npos);
+
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 100; ++j) {
+      LOG_S_EVERY_T(kSinkId, 50, sl::Level::warning, "every t %", std::to_string(j));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  }
+  fileStrings = lines();
+  REQUIRE(fileStrings.size() == 16);
+  REQUIRE(fileStrings[14].find("WARNING") != std::string::npos);
+  REQUIRE(fileStrings[14].find("sl: 99 records suppressed") != std::string::npos);
+  REQUIRE(fileStrings[15].find("every t 0") != std::string::npos);
+
+  for (int i = 0; i < 100; ++i) {
+    LOG_S_RATE_LIMITED(kSinkId, 0.001, 4, sl::Level::error, "rate limited %", std::to_string(i));
+  }
+  REQUIRE(lines().size() == 20);
+}
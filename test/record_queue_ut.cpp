@@ -0,0 +1,189 @@
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "catch.hh"
+#include <log/record_queue.h>
+
+using namespace sl::detail;
+
+namespace {
+
+/* Waits for records like the writer thread does */
+void waitPop(RecordQueue& queue, RecordBatch* batch) {
+  while (!queue.tryPop(batch)) {
+    std::this_thread::yield();
+  }
+}
+
+std::vector<std::string> popAll(RecordQueue& queue) {
+  RecordBatch batch;
+  std::vector<std::string> result;
+
+  waitPop(queue, &batch);
+  for (const auto& record: batch) {
+    result.push_back(record.data);
+  }
+  queue.done(batch);
+
+  return result;
+}
+
+}
+
+TEST_CASE("RecordQueueTest", "[record_queue]") {
+  sl::AsyncOptions options(2);
+
+  SECTION("drop newest") {
+    options.overflow = sl::OverflowPolicy::dropNewest;
+    RecordQueue queue(options);
+
+    REQUIRE(queue.push(Record("1", 0, sl::Level::info)));
+    REQUIRE(queue.push(Record("2", 0, sl::Level::info)));
+    REQUIRE(!queue.push(Record("3", 0, sl::Level::info)));
+    REQUIRE(queue.takeDropped() == 0);
+    REQUIRE(popAll(queue) == std::vector<std::string>({"1", "2"}));
+    REQUIRE(queue.takeDropped() == 1);
+    REQUIRE(queue.takeDropped() == 0);
+    REQUIRE(queue.stats().dropped == 1);
+    REQUIRE(queue.stats().written == 2);
+  }
+
+  SECTION("drop oldest") {
+    options.overflow = sl::OverflowPolicy::dropOldest;
+    RecordQueue queue(options);
+
+    queue.push(Record("1", 0, sl::Level::info));
+    queue.push(Record("2", 0, sl::Level::info));
+    REQUIRE(!queue.push(Record("3", 0, sl::Level::info)));
+    REQUIRE(popAll(queue) == std::vector<std::string>({"2", "3"}));
+  }
+
+  SECTION("drop below level") {
+    options.overflow = sl::OverflowPolicy::dropBelowLevel;
+    RecordQueue queue(options);
+
+    queue.push(Record("1", 0, sl::Level::error));
+    queue.push(Record("2", 0, sl::Level::info));
+    REQUIRE(!queue.push(Record("3", 0, sl::Level::debug)));
+    REQUIRE(!queue.push(Record("4", 0, sl::Level::warning)));
+    REQUIRE(!queue.push(Record("5", 0, sl::Level::critical)));
+    REQUIRE(popAll(queue) == std::vector<std::string>({"1", "4"}));
+    REQUIRE(queue.stats().dropped == 3);
+  }
+
+  SECTION("block with timeout") {
+    options.blockTimeout = 10;
+    RecordQueue queue(options);
+
+    queue.push(Record("1", 0, sl::Level::info));
+    queue.push(Record("2", 0, sl::Level::info));
+    REQUIRE(!queue.push(Record("3", 0, sl::Level::info)));
+    REQUIRE(queue.stats().blocked == 1);
+    REQUIRE(queue.stats().dropped == 1);
+  }
+
+  SECTION("block") {
+    options.blockTimeout = -1;
+    RecordQueue queue(options);
+
+    queue.push(Record("1", 0, sl::Level::info));
+    queue.push(Record("2", 0, sl::Level::info));
+    std::thread consumer([&queue] { 
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      popAll(queue);
+    });
+    REQUIRE(queue.push(Record("3", 0, sl::Level::info)));
+    consumer.join();
+    REQUIRE(queue.stats().blocked == 1);
+    REQUIRE(queue.stats().dropped == 0);
+  }
+
+  SECTION("priority lane") {
+    options.queueSize = 100;
+    options.priorityQueueSize = 1;
+    RecordQueue queue(options);
+
+    queue.push(Record("1", 0, sl::Level::info));
+    queue.push(Record("2", 0, sl::Level::error));
+    queue.push(Record("3", 0, sl::Level::critical));
+    queue.push(Record("4", 0, sl::Level::debug));
+    REQUIRE(popAll(queue) == std::vector<std::string>({"2"}));
+    /* the lane was full */
+    REQUIRE(popAll(queue) == std::vector<std::string>({"1", "3", "4"}));
+  }
+
+  SECTION("priority flush") {
+    options.queueSize = 100;
+    options.priorityQueueSize = 10;
+    options.priorityFlush = true;
+    RecordQueue queue(options);
+    std::atomic<bool> written(false);
+
+    queue.push(Record("1", 0, sl::Level::info));
+    std::thread consumer([&queue, &written] { 
+      RecordBatch batch;
+      waitPop(queue, &batch);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      written = true;
+      queue.done(batch);
+    });
+
+    /* doesn't wait for the older bulk record */
+    queue.push(Record("2", 0, sl::Level::error));
+    REQUIRE(written);
+    consumer.join();
+    REQUIRE(popAll(queue) == std::vector<std::string>({"1"}));
+  }
+
+  SECTION("visit") {
+    options.queueSize = 100;
+    options.priorityQueueSize = 10;
+    RecordQueue queue(options);
+
+    queue.push(Record("1", 0, sl::Level::info));
+    queue.push(Record("2", 0, sl::Level::error));
+    std::vector<std::string> visited;
+    REQUIRE(queue.tryVisit([&visited](const Record& record) { 
+      visited.push_back(record.data); 
+    }));
+    REQUIRE(visited == std::vector<std::string>({"2", "1"}));
+
+    /* the taken batch is the writer's */
+    popAll(queue);
+    visited.clear();
+    REQUIRE(queue.tryVisit([&visited](const Record& record) { 
+      visited.push_back(record.data); 
+    }));
+    REQUIRE(visited == std::vector<std::string>({"1"}));
+  }
+
+  SECTION("wait done") {
+    RecordQueue queue(options);
+    std::vector<std::string> written;
+    std::atomic<bool> stopped(false);
+
+    std::thread consumer([&queue, &written, &stopped] { 
+      RecordBatch batch;
+      while (!stopped) {
+        if (!queue.tryPop(&batch)) {
+          std::this_thread::yield();
+          continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        for (const auto& record: batch) {
+          written.push_back(record.data);
+        }
+        queue.done(batch);
+      }
+    });
+
+    queue.push(Record("1", 0, sl::Level::info));
+    queue.push(Record("2", 0, sl::Level::info));
+    queue.waitDone();
+    REQUIRE(written.size() == 2);
+    stopped = true;
+    queue.stop();
+    consumer.join();
+  }
+}
@@ -0,0 +1,37 @@
+#include <string>
+#include "catch.hh"
+#include <log/repeat_filter.h>
+
+using namespace sl::detail;
+
+TEST_CASE("RepeatFilterTest", "[repeat_filter]") {
+  RepeatFilter filter;
+  const std::string kFirst = "first";
+  const std::string kSecond = "second";
+  auto first = RepeatFilter::hash(kFirst.data(), kFirst.size());
+  auto second = RepeatFilter::hash(kSecond.data(), kSecond.size());
+  REQUIRE(first != second);
+  REQUIRE(RepeatFilter::hash("", 0) != 0);
+
+  uint64_t repeats = 100;
+  sl::Level level = sl::Level::critical;
+  REQUIRE(filter.pass(first, sl::Level::info, repeats, level));
+  REQUIRE(repeats == 0);
+  for (int i = 0; i < 10; ++i) {
+    REQUIRE_FALSE(filter.pass(first, sl::Level::info, repeats, level));
+  }
+
+  /* the level is a part of the record */
+  REQUIRE(filter.pass(first, sl::Level::error, repeats, level));
+  REQUIRE(repeats == 10);
+  REQUIRE(level == sl::Level::info);
+
+  REQUIRE_FALSE(filter.pass(first, sl::Level::error, repeats, level));
+  REQUIRE(filter.take(level) == 1);
+  REQUIRE(level == sl::Level::error);
+  REQUIRE(filter.take(level) == 0);
+
+  REQUIRE_FALSE(filter.pass(first, sl::Level::error, repeats, level));
+  REQUIRE(filter.pass(second, sl::Level::error, repeats, level));
+  REQUIRE(repeats == 1);
+}
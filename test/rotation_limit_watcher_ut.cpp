@@ -1,6 +1,7 @@
 #include "catch.hh"
 #include <log/rotation_limit_watcher.h>
 #include <log/rotation_limit_watcher_handler.h>
+#include <log/utils.h>
 
 class TestWatcherHandler : public sl::detail::RotationLimitWatcherHandler {
 public:
@@ -56,4 +57,97 @@ TEST_CASE("LimitWatcherTest", "[limit_watcher_test]") {
   watcher.addWritten(6);
   REQUIRE(handler.nextFileCalled == true);
   REQUIRE(handler.clearNeededCalled == true);
-}
\ No newline at end of file
+}
+
+TEST_CASE("LimitWatcherTimeTest", "[limit_watcher_test]") {
+  using namespace sl::detail;
+
+  const int64_t kSecond = 1000000;
+  const int64_t kStart = 1500000000 * kSecond;
+
+  TestWatcherHandler handler;
+  REQUIRE_THROWS(RotationLimitWatcher(30, 10, &handler, 
+      sl::RotationOptions(sl::RotationPolicy::time, sl::RotationPeriod::interval)));
+
+  SECTION("Interval") {
+    RotationLimitWatcher watcher(1000, 10, &handler, 
+        sl::RotationOptions(sl::RotationPolicy::time, 
+                            sl::RotationPeriod::interval, 
+                            60));
+
+    /* first record starts the period */
+    watcher.checkTime(kStart);
+    REQUIRE(watcher.periodStart() == 1500000000 - 1500000000 % 60);
+    watcher.addWritten(50);
+    REQUIRE(handler.nextFileCalled == false);
+
+    watcher.checkTime(watcher.periodStart() * kSecond + 59 * kSecond);
+    REQUIRE(handler.nextFileCalled == false);
+
+    auto oldPeriodStart = watcher.periodStart();
+    watcher.checkTime(oldPeriodStart * kSecond + 60 * kSecond);
+    REQUIRE(handler.nextFileCalled == true);
+    REQUIRE(watcher.periodStart() == oldPeriodStart + 60);
+    handler.nextFileCalled = false;
+
+    /* empty files are not rotated */
+    watcher.checkTime(oldPeriodStart * kSecond + 200 * kSecond);
+    REQUIRE(handler.nextFileCalled == false);
+    REQUIRE(watcher.periodStart() == oldPeriodStart + 180);
+  }
+
+  SECTION("Hourly") {
+    RotationLimitWatcher watcher(1000, 10, &handler, 
+        sl::RotationOptions(sl::RotationPolicy::time, 
+                            sl::RotationPeriod::hourly));
+
+    watcher.checkTime(kStart);
+    auto local = ts::localTime(watcher.periodStart());
+    REQUIRE(local.tm_min == 0);
+    REQUIRE(local.tm_sec == 0);
+    REQUIRE(watcher.periodStart() <= 1500000000);
+    REQUIRE(watcher.periodStart() > 1500000000 - 3600);
+  }
+
+  SECTION("Daily") {
+    RotationLimitWatcher watcher(1000, 10, &handler, 
+        sl::RotationOptions(sl::RotationPolicy::time, 
+                            sl::RotationPeriod::daily));
+
+    watcher.checkTime(kStart);
+    auto local = ts::localTime(watcher.periodStart());
+    REQUIRE(local.tm_hour == 0);
+    REQUIRE(local.tm_min == 0);
+    REQUIRE(local.tm_sec == 0);
+  }
+
+  SECTION("Size or time") {
+    RotationLimitWatcher watcher(1000, 10, &handler, 
+        sl::RotationOptions(sl::RotationPolicy::sizeOrTime, 
+                            sl::RotationPeriod::interval, 
+                            60));
+
+    watcher.checkTime(kStart);
+    watcher.addWritten(9);
+    REQUIRE(handler.nextFileCalled == false);
+    watcher.addWritten(1);
+    REQUIRE(handler.nextFileCalled == true);
+    handler.nextFileCalled = false;
+
+    watcher.addWritten(5);
+    REQUIRE(handler.nextFileCalled == false);
+    watcher.checkTime(kStart + 60 * kSecond);
+    REQUIRE(handler.nextFileCalled == true);
+  }
+
+  SECTION("Stale active file") {
+    RotationLimitWatcher watcher(1000, 10, &handler, 
+        sl::RotationOptions(sl::RotationPolicy::time, 
+                            sl::RotationPeriod::interval, 
+                            60));
+
+    watcher.setActiveFile(5, 1500000000 - 3600);
+    watcher.checkTime(kStart);
+    REQUIRE(handler.nextFileCalled == true);
+  }
+}
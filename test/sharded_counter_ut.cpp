@@ -0,0 +1,26 @@
+#include <thread>
+#include <vector>
+#include "catch.hh"
+#include <log/sharded_counter.h>
+
+using namespace sl::detail;
+
+TEST_CASE("ShardedCounterTest", "[sharded_counter]") {
+  ShardedCounter counter;
+  REQUIRE(counter.value() == 0);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < ShardedCounter::kShards * 2; ++t) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < 10000; ++i) {
+        counter.add();
+      }
+      counter.add(5);
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+
+  REQUIRE(counter.value() == ShardedCounter::kShards * 2 * 10005);
+}
@@ -0,0 +1,74 @@
+#include <thread>
+#include <vector>
+#include "catch.hh"
+#include <log/staging_buffers.h>
+
+using namespace sl::detail;
+
+TEST_CASE("SpscRingTest", "[staging_buffers]") {
+  SpscRing ring(3);
+  Record record("1", 0, sl::Level::info);
+
+  REQUIRE(ring.front() == nullptr);
+  for (int i = 0; i < 4; ++i) {
+    Record record(std::to_string(i), i, sl::Level::info);
+    REQUIRE(ring.push(record));
+  }
+  REQUIRE(!ring.push(record));
+  REQUIRE(record.data == "1");
+
+  REQUIRE(ring.front()->data == "0");
+  ring.pop();
+  REQUIRE(ring.push(record));
+  REQUIRE(ring.pushed() == 5);
+  REQUIRE(ring.popped() == 1);
+}
+
+TEST_CASE("StagingBuffersTest", "[staging_buffers]") {
+  sl::AsyncOptions options(1000, sl::OverflowPolicy::dropNewest);
+  options.perThread = true;
+  StagingBuffers buffers(options);
+  std::vector<Record> written;
+  auto write = [&written](const Record& record) { written.push_back(record); };
+
+  SECTION("merge by timestamp") {
+    const int kThreads = 4;
+    const int kRecords = 100;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&buffers, t] {
+        for (int i = 0; i < kRecords; ++i) {
+          buffers.push(Record(std::to_string(t), i * kThreads + t, sl::Level::info));
+        }
+      });
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+
+    REQUIRE(buffers.drain(write) == kThreads * kRecords);
+    for (size_t i = 0; i < written.size(); ++i) {
+      REQUIRE(written[i].timestamp == (int64_t)i);
+    }
+
+    /* the exited threads' rings are gone, their counters stay */
+    REQUIRE(buffers.threads() == 0);
+    REQUIRE(buffers.stats().queued == kThreads * kRecords);
+    REQUIRE(buffers.stats().written == kThreads * kRecords);
+  }
+
+  SECTION("overflow") {
+    sl::AsyncOptions small(2, sl::OverflowPolicy::dropNewest);
+    small.perThread = true;
+    StagingBuffers buffers(small);
+
+    REQUIRE(buffers.push(Record("1", 0, sl::Level::info)));
+    REQUIRE(buffers.push(Record("2", 0, sl::Level::info)));
+    REQUIRE(!buffers.push(Record("3", 0, sl::Level::info)));
+    REQUIRE(buffers.takeDropped() == 0);
+    REQUIRE(buffers.drain(write) == 2);
+    REQUIRE(buffers.takeDropped() == 1);
+    REQUIRE(buffers.threads() == 1);
+  }
+}
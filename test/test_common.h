@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <log/file_entry.h>
 #include <log/utils.h>
 
@@ -7,6 +8,7 @@ using namespace sl::detail;
 
 const std::string kPath = "/test/path";
 const std::string kBaseName = "test";
+const int64_t kLastModified = 1500000000;
 
 class TestFileStream : public IFileStream {
 public:
@@ -20,24 +22,39 @@ public:
     opened = false;
   }
 
-  virtual void write(const void* /*data*/, size_t size) override {
+  virtual int write(const void* /*data*/, size_t size) override {
+    if (error != 0)
+      return error;
     written += size;
+    return 0;
+  }
+
+  virtual void sync() override {
+    ++syncs;
   }
 
   virtual bool isOpened() const override {
     return opened;
   }
 
+  virtual int fd() const override {
+    return -1;
+  }
+
   bool opened = true;
   int64_t written = 0;
+  std::atomic<int> syncs{0};
+  int error = 0;
   int64_t fileSize;
 };
 
 class TestFileEntry : public IFileEntry {
 public:
-  TestFileEntry(const std::string& name, int64_t fileSize)
+  TestFileEntry(const std::string& name, int64_t fileSize, 
+                int64_t lastModified = kLastModified)
     : m_name(name),
-      m_fileSize(fileSize) {}
+      m_fileSize(fileSize),
+      m_lastModified(lastModified) {}
 
   virtual void remove() override { m_removed = true; }
   virtual void rename(const std::string& newName) override {
@@ -45,6 +62,7 @@ public:
   }
   virtual std::string name() const override { return m_name; }
   virtual int64_t size() const override { return m_removed ? 0ll : m_fileSize; }
+  virtual int64_t lastModified() const override { return m_lastModified; }
 
   virtual bool exists() const override { return false; }
   virtual FileStreamPtr open() override { return FileStreamPtr(new TestFileStream(m_fileSize)); }
@@ -52,14 +70,17 @@ public:
 private:
   std::string m_name;
   int64_t m_fileSize;
+  int64_t m_lastModified;
   bool m_removed = false;
 };
 
 class TestFileEntryFactory : public IFileEntryFactory {
 public:
-  TestFileEntryFactory(int64_t entrySize, size_t count)
+  /* Existent entry i is timeStep * i seconds older than kLastModified */
+  TestFileEntryFactory(int64_t entrySize, size_t count, int64_t timeStep = 0)
     : m_count(count),
-      m_entrySize(entrySize) {}
+      m_entrySize(entrySize),
+      m_timeStep(timeStep) {}
 
   virtual FileEntryPtr create(const std::string& path,
                               const std::string& baseName,
@@ -92,11 +113,13 @@ private:
                     str::join(fs::join(kPath, kBaseName),
                               (i == 0 ? "" : std::to_string(i)),
                               ".log"),
-                    m_entrySize));
+                    m_entrySize,
+                    kLastModified - m_timeStep * i));
   }
 private:
   size_t m_count;
   int64_t m_entrySize;
+  int64_t m_timeStep;
   std::vector<IFileEntry*> m_entries;
 };
 
@@ -0,0 +1,49 @@
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "catch.hh"
+#include <log/waiter.h>
+
+using namespace sl::detail;
+
+TEST_CASE("WaiterTest", "[waiter]") {
+  for (auto strategy: {sl::WaitStrategy::spin, 
+                       sl::WaitStrategy::spinYield, 
+                       sl::WaitStrategy::park}) {
+    Waiter waiter(strategy);
+    std::atomic<int> published(0);
+
+    std::thread producer([&waiter, &published] {
+      for (int i = 0; i < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ++published;
+        waiter.notify();
+      }
+    });
+
+    for (int i = 1; i <= 3; ++i) {
+      waiter.wait([&published, i] { return published >= i; });
+      REQUIRE(published >= i);
+    }
+    producer.join();
+  }
+}
+
+TEST_CASE("WaiterParkTest", "[waiter]") {
+  Waiter waiter(sl::WaitStrategy::park);
+  std::atomic<bool> ready(false);
+
+  std::thread producer([&waiter, &ready] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ready = true;
+    waiter.notify();
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  waiter.wait([&ready] { return (bool)ready; });
+  producer.join();
+
+  /* woken up by the notification rather than the park timeout */
+  REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(90));
+  REQUIRE(waiter.wakeups() >= 1);
+}
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include "catch.hh"
+#include <log/worker.h>
+
+#if defined (__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+using namespace sl::detail;
+
+TEST_CASE("WorkerTest", "[worker]") {
+  std::vector<int> result;
+  std::atomic<int> done(0);
+
+  SECTION("order") {
+    {
+      Worker worker;
+      worker.post([&] { result.push_back(3); ++done; }, std::chrono::milliseconds(50));
+      worker.post([&] { result.push_back(1); ++done; });
+      worker.post([&] { result.push_back(2); ++done; });
+
+      while (done != 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    REQUIRE(result == std::vector<int>({1, 2, 3}));
+  }
+
+  SECTION("exceptions") {
+    {
+      Worker worker;
+      worker.post([] { throw std::runtime_error("task failed"); });
+      worker.post([&] { ++done; });
+      while (done != 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    REQUIRE(done == 1);
+  }
+
+  SECTION("stop") {
+    auto start = std::chrono::steady_clock::now();
+    {
+      Worker worker;
+      worker.post([&] { ++done; }, std::chrono::seconds(60));
+      worker.stop();
+      worker.post([&] { ++done; });
+    }
+
+    REQUIRE(done == 0);
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+  }
+}
+
+#if defined (__linux__)
+TEST_CASE("WorkerThreadOptionsTest", "[worker]") {
+  sl::ThreadOptions options(10);
+  options.cpus = {0};
+  cpu_set_t cpus;
+  int nice = 0;
+  std::atomic<bool> done(false);
+
+  {
+    Worker worker(options);
+    worker.post([&] { 
+      pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+      done = true;
+    });
+    while (!done) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  REQUIRE(CPU_COUNT(&cpus) == 1);
+  REQUIRE(CPU_ISSET(0, &cpus));
+  REQUIRE(nice == 10);
+}
+#endif
@@ -0,0 +1,22 @@
+/* Prints the records kept in a flight recorder file (see
+   sl::FlightRecorderOptions), oldest first. */
+
+#include <iostream>
+#include <stdexcept>
+#include <log/flight_recorder.h>
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: sl_recover <file.flight>" << std::endl;
+    return 2;
+  }
+
+  try {
+    std::cout << sl::detail::FlightRecorder::recover(argv[1]);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}